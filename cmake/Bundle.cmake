@@ -0,0 +1,56 @@
+# Build the single-file submissions, run by the submission target of src/CMakeLists.txt as
+#     cmake -DINCLUDE_DIR=... -DOUTPUT_DIR=... -DHEADERS=server.h,client.h -P Bundle.cmake
+# The judge takes server.h (ACMOJ 2876) and client.h (ACMOJ 2877) as one file each, so every header of INCLUDE_DIR that
+# they include is pasted in place of its #include, once, recursively. The pasted headers keep their include guards,
+# so the two bundles can still be included together the way advanced.cpp does.
+cmake_minimum_required(VERSION 3.10)
+
+foreach (variable INCLUDE_DIR OUTPUT_DIR HEADERS)
+  if (NOT DEFINED ${variable})
+    message(FATAL_ERROR "Bundle.cmake needs -D${variable}=...")
+  endif ()
+endforeach ()
+
+# Set output to the text of header with its local includes pasted in. The content is handled as one string, never
+# as a list, so the semicolons of the code survive.
+function(bundle header output)
+  file(READ ${INCLUDE_DIR}/${header} content)
+  # CMake has no multiline regex, so a newline in front lets the first line match like the others
+  string(PREPEND content "\n")
+  set(result "")
+  while (TRUE)
+    # Only an #include that starts a line, indented or not, and not one quoted in a comment
+    string(REGEX MATCH "\n[ \t]*#[ \t]*include[ \t]*\"([^\"]+)\"" match "${content}")
+    if (NOT match)
+      break ()
+    endif ()
+    set(included ${CMAKE_MATCH_1})
+    string(FIND "${content}" "${match}" position)
+    string(LENGTH "${match}" length)
+    math(EXPR rest "${position} + ${length}")
+    string(SUBSTRING "${content}" 0 ${position} before)
+    string(SUBSTRING "${content}" ${rest} -1 content)
+    string(APPEND result "${before}\n")
+    get_property(done GLOBAL PROPERTY bundled_headers)
+    if (NOT included IN_LIST done)
+      if (NOT EXISTS ${INCLUDE_DIR}/${included})
+        message(FATAL_ERROR "Bundle.cmake: ${header} includes ${included}, which is not in ${INCLUDE_DIR}")
+      endif ()
+      set_property(GLOBAL APPEND PROPERTY bundled_headers ${included})
+      bundle(${included} pasted)
+      string(APPEND result "// ---- ${included} ----\n${pasted}// ---- end of ${included} ----")
+    endif ()
+  endwhile ()
+  string(APPEND result "${content}")
+  string(SUBSTRING "${result}" 1 -1 result)
+  set(${output} "${result}" PARENT_SCOPE)
+endfunction()
+
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+string(REPLACE "," ";" HEADERS "${HEADERS}")
+foreach (header ${HEADERS})
+  set_property(GLOBAL PROPERTY bundled_headers ${header})
+  bundle(${header} bundled)
+  file(WRITE ${OUTPUT_DIR}/${header} "// Generated from ${header} by cmake/Bundle.cmake; edit the sources instead.\n")
+  file(APPEND ${OUTPUT_DIR}/${header} "${bundled}")
+endforeach ()
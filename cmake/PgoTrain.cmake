@@ -0,0 +1,79 @@
+# The training workload of profile-guided optimization, run by the pgo-train target of src/CMakeLists.txt as
+#     cmake -DSERVER=... -DCLIENT=... -DBATCH=... -DPGO_DIR=... -DWORK_DIR=... -DCOMPILER_ID=... [-DLLVM_PROFDATA=...]
+#           -P PgoTrain.cmake
+# It plays the instrumented targets the way they are used: the batch harness on the usual board sizes, the client on
+# a single game and on TestBatch(), and the server on a fixed map in both output modes. The profiles land in PGO_DIR.
+
+foreach (variable SERVER CLIENT BATCH PGO_DIR WORK_DIR COMPILER_ID)
+  if (NOT DEFINED ${variable})
+    message(FATAL_ERROR "PgoTrain.cmake needs -D${variable}=...")
+  endif ()
+endforeach ()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+# The profiles of an earlier training would be added to the new ones
+file(GLOB stale_profiles ${PGO_DIR}/*.gcda ${PGO_DIR}/*.profraw ${PGO_DIR}/*.profdata)
+if (stale_profiles)
+  file(REMOVE ${stale_profiles})
+endif ()
+
+# Run a command with the given input file, or none, and stop the training if it fails
+function(train name input)
+  message(STATUS "pgo-train: ${name}")
+  if (input)
+    set(input_option INPUT_FILE ${input})
+  endif ()
+  execute_process(COMMAND ${ARGN} ${input_option} RESULT_VARIABLE result
+                  OUTPUT_FILE ${WORK_DIR}/${name}.out ERROR_FILE ${WORK_DIR}/${name}.err)
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "pgo-train: ${name} failed (${result}), see ${WORK_DIR}/${name}.err")
+  endif ()
+endfunction()
+
+# A fixed 16 x 30 map with 80 mines, and the operations that win it: mark every mine, then visit every other block
+set(rows 16)
+set(columns 30)
+set(map "${rows} ${columns}\n")
+set(marks "")
+set(visits "0 1 0\n0 1 2\n")
+math(EXPR last_row "${rows} - 1")
+math(EXPR last_column "${columns} - 1")
+foreach (i RANGE ${last_row})
+  foreach (j RANGE ${last_column})
+    math(EXPR mine "(${i} * 7 + ${j} * 13) % 6")
+    if (mine EQUAL 0)
+      string(APPEND map "X")
+      string(APPEND marks "${i} ${j} 1\n")
+    else ()
+      string(APPEND map ".")
+      string(APPEND visits "${i} ${j} 0\n")
+    endif ()
+  endforeach ()
+  string(APPEND map "\n")
+endforeach ()
+file(WRITE ${WORK_DIR}/server.in "${map}${marks}${visits}")
+file(WRITE ${WORK_DIR}/client.in "${map}0 1\n")
+file(WRITE ${WORK_DIR}/client_batch.in "30 30 150 7 1\n")
+
+train(batch_30x30 "" ${BATCH} 30 30 150 11 1 4000)
+train(batch_16x30 "" ${BATCH} 16 30 99 12 1 4000)
+train(batch_9x9 "" ${BATCH} 9 9 10 13 1 4000)
+train(batch_rollout "" ${BATCH} 30 30 150 14 1 300 1 --rollout)
+train(client "${WORK_DIR}/client.in" ${CLIENT})
+train(client_batch "${WORK_DIR}/client_batch.in" ${CLIENT} --batch)
+train(server "${WORK_DIR}/server.in" ${SERVER})
+train(server_diff "${WORK_DIR}/server.in" ${SERVER} --diff)
+
+# Clang leaves raw profiles, which -fprofile-use only takes once they are merged
+if (NOT COMPILER_ID STREQUAL "GNU")
+  if (NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "pgo-train: llvm-profdata is needed to merge the profiles of ${COMPILER_ID}")
+  endif ()
+  file(GLOB raw_profiles ${PGO_DIR}/*.profraw)
+  execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/default.profdata ${raw_profiles}
+                  RESULT_VARIABLE result)
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "pgo-train: llvm-profdata merge failed (${result})")
+  endif ()
+endif ()
+message(STATUS "pgo-train: profiles are in ${PGO_DIR}; reconfigure with -DMINESWEEPER_PGO=USE and build")
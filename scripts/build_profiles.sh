@@ -0,0 +1,46 @@
+#!/bin/sh
+# Build every profile of src/CMakeLists.txt and compare them on the batch workload, played on one thread.
+#     scripts/build_profiles.sh [build root] [games]
+# The builds go to build root (default build-profiles); the speedups are relative to the Debug build, which is how the
+# targets were built before the optimized profiles existed.
+set -e
+
+root=${1:-build-profiles}
+games=${2:-2000}
+source_dir=$(cd "$(dirname "$0")/.." && pwd)
+jobs=$(nproc 2>/dev/null || echo 1)
+
+configure_and_build() {
+  name=$1
+  shift
+  cmake -S "$source_dir" -B "$root/$name" "$@" >/dev/null
+  cmake --build "$root/$name" -j"$jobs" >/dev/null
+}
+
+configure_and_build debug -DCMAKE_BUILD_TYPE=Debug
+configure_and_build release -DCMAKE_BUILD_TYPE=Release -DMINESWEEPER_LTO=OFF
+configure_and_build lto -DCMAKE_BUILD_TYPE=Release
+configure_and_build native -DCMAKE_BUILD_TYPE=Release -DMINESWEEPER_NATIVE=ON
+# Profile-guided: build instrumented, train, then rebuild with the profiles in the same directory
+cmake -S "$source_dir" -B "$root/pgo" -DCMAKE_BUILD_TYPE=Release -DMINESWEEPER_PGO=GENERATE >/dev/null
+cmake --build "$root/pgo" --target pgo-train -j"$jobs" >/dev/null
+configure_and_build pgo -DMINESWEEPER_PGO=USE
+cmake -S "$source_dir" -B "$root/pgo-native" -DCMAKE_BUILD_TYPE=Release -DMINESWEEPER_NATIVE=ON \
+  -DMINESWEEPER_PGO=GENERATE >/dev/null
+cmake --build "$root/pgo-native" --target pgo-train -j"$jobs" >/dev/null
+configure_and_build pgo-native -DMINESWEEPER_PGO=USE
+
+# Games per second of one batch run, from the last line of its report
+games_per_second() {
+  "$root/$1/src/batch" $2 1 "$games" 1 | awk '$1 == "games/sec" { print $2 }'
+}
+
+for workload in "30 30 150 123" "16 30 99 321"; do
+  echo "batch $workload, $games games on one thread"
+  baseline=
+  for profile in debug release lto native pgo pgo-native; do
+    rate=$(games_per_second $profile "$workload")
+    baseline=${baseline:-$rate}
+    echo "$profile $rate $baseline" | awk '{ printf "  %-12s %10.1f games/s %6.2fx\n", $1, $2, $2 / $3 }'
+  done
+done
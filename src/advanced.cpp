@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -9,13 +10,48 @@
 #include "server.h"
 
 bool batch_mode = false;
+bool text_bridge = false;      // Pass the map through PrintMap() and ReadMap() as text, the way the OJ judger does
+bool batch_actions = false;    // Skip passing the map while the solver still has proven actions queued (--batch-actions)
+bool rollout_guesses = false;  // Guess with the rollout guesser (see rollout.h) on every hardware thread (--rollout)
+
+/**
+ * @brief Pass the map from the server to the client as text
+ * @details PrintMap() is redirected into a string, which then becomes the input of ReadMap(). This is what the OJ
+ * judger does, and it formats and parses the whole map on every move.
+ */
+void TextBridge() {
+  std::string str;
+  std::ostringstream oss;
+  std::streambuf *old_output_buffer = std::cout.rdbuf();
+  std::cout.rdbuf(oss.rdbuf());
+  // Here, we redirect the output stream to the string stream.
+  // By this way the output of PrintMap() would be stored in the string.
+  // If you do not understand, you can try to compare it with freopen, which redirect the output stream to a file.
+  PrintMap();
+  std::cout.rdbuf(old_output_buffer);  // Restore the output buffer
+  str = oss.str();                     // Read the output
+  std::istringstream iss(str);         // Redirect the input to the string, which stores the output recently
+  std::streambuf *old_input_buffer = std::cin.rdbuf();
+  std::cin.rdbuf(iss.rdbuf());
+  ReadMap();
+  std::cin.rdbuf(old_input_buffer);
+}
+
+/**
+ * @brief Pass the map from the server to the client in memory
+ * @details Only the blocks changed by the last operation are handed to the client, with no formatting or parsing.
+ */
+void DirectBridge() {
+  for (auto [r, c] : CollectDirtyBlocks()) {
+    UpdateBlock(r, c, BlockSymbol(r, c));
+  }
+}
 
 /**
  * @brief The implementation of function Execute
  * @details Use it only when trying advanced task. Do NOT modify it before discussing with TA.
  */
 void Execute(int row, int column, int type) {
-  std::string str;
   if (type == 0) {
     VisitBlock(row, column);
   } else if (type == 1) {
@@ -33,20 +69,15 @@ void Execute(int row, int column, int type) {
       return;
     }
   }
-  std::ostringstream oss;
-  std::streambuf *old_output_buffer = std::cout.rdbuf();
-  std::cout.rdbuf(oss.rdbuf());
-  // Here, we redirect the output stream to the string stream.
-  // By this way the output of PrintMap() would be stored in the string.
-  // If you do not understand, you can try to compare it with freopen, which redirect the output stream to a file.
-  PrintMap();
-  std::cout.rdbuf(old_output_buffer);  // Restore the output buffer
-  str = oss.str();                     // Read the output
-  std::istringstream iss(str);         // Redirect the input to the string, which stores the output recently
-  std::streambuf *old_input_buffer = std::cin.rdbuf();
-  std::cin.rdbuf(iss.rdbuf());
-  ReadMap();
-  std::cin.rdbuf(old_input_buffer);
+  // The server keeps every change until the next bridge, so the client catches up on all of them at once
+  if (batch_actions && solver.HasPendingActions()) {
+    return;
+  }
+  if (text_bridge) {
+    TextBridge();
+  } else {
+    DirectBridge();
+  }
   // PrintMap(); // These two lines may help you debug
   // std::cout << std::endl;
 }
@@ -70,14 +101,13 @@ void TestSingle() {
  * Running test many times (to simulate real tests).
  * You just need to input rows, columns, mine_count and random seed.
  *
- * @note If you want to use this function, you should modify the program a little bit:
- *   - Modify your server so that it supports dealing with multiple maps in a single run;
- *   - Remove the line "exit(0)" in function ExitGame(). (Or your program may exit immediately after running a single test).
+ * @note The server keeps the process alive after each game because exit_after_game is turned off here.
  * The special judger on OJ will be a special version of server.h.
  * We'll do some optimizations to it so that it will be faster.
  */
 void TestBatch() {
   batch_mode = true;
+  exit_after_game = false;
   int rows, columns, mine_count, min_dist;
   uint64_t seed;
   std::cin >> rows >> columns >> mine_count >> seed >> min_dist;
@@ -99,7 +129,30 @@ void TestBatch() {
   }
 }
 
-int main() {
-  TestSingle();
-  // TestBatch();
+// Run with --batch to play TestBatch() instead of a single game; --batch-actions and --rollout set the options above
+int main(int argc, char *argv[]) {
+  bool batch = false;
+  for (int k = 1; k < argc; k++) {
+    if (std::strcmp(argv[k], "--batch") == 0) {
+      batch = true;
+    } else if (std::strcmp(argv[k], "--batch-actions") == 0) {
+      batch_actions = true;
+    } else if (std::strcmp(argv[k], "--rollout") == 0) {
+      rollout_guesses = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--batch] [--batch-actions] [--rollout]" << std::endl;
+      return 1;
+    }
+  }
+  if (rollout_guesses) {
+    RolloutConfig config;
+    config.enabled = true;
+    config.threads = 0;
+    solver.SetRollout(config);
+  }
+  if (batch) {
+    TestBatch();
+  } else {
+    TestSingle();
+  }
 }
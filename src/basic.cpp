@@ -1,12 +1,27 @@
+#include <cstring>
 #include <iostream>
 
 #include "server.h"
+#include "wire.h"
 
 /**
  * This is the main function of the game. You don't need to modify it.
  * Just finish server.h and run!
+ *
+ * Run it with --diff to print only the blocks changed by each operation (see PrintDiff()) instead of the whole map.
+ * The initial map and the final result are printed the same way in both modes.
+ *
+ * Run it with --binary or --binary-rle to speak the binary protocol of wire.h instead, with packed or run-length
+ * encoded frames.
  */
-int main() {
+int main(int argc, char *argv[]) {
+  bool diff_mode = argc > 1 && std::strcmp(argv[1], "--diff") == 0;
+  if (argc > 1 && (std::strcmp(argv[1], "--binary") == 0 || std::strcmp(argv[1], "--binary-rle") == 0)) {
+    FdReader in(STDIN_FILENO);
+    FdWriter out(STDOUT_FILENO);
+    ServeBinary(game, in, out, std::strcmp(argv[1], "--binary") == 0 ? kPacked : kRunLength);
+    return 0;
+  }
   InitMap();
   PrintMap();
   while (true) {
@@ -20,7 +35,11 @@ int main() {
     } else if (type == 2) {
       AutoExplore(pos_x, pos_y);
     }
-    PrintMap();
+    if (diff_mode) {
+      PrintDiff();
+    } else {
+      PrintMap();
+    }
     if (game_state != 0) {
       ExitGame();
     }
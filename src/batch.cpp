@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "corpus.h"
+#include "harness.h"
+#include "trace.h"
+
+/**
+ * Evaluate the client's solver on many generated maps, using every core.
+ * Usage: batch rows columns mine_count seed min_dist games [threads] [--compat] [--rollout] [--pipelined]
+ *              [--save-corpus file]
+ *        batch --corpus file [threads] [--rollout] [--pipelined]
+ * The parameters mean the same as in TestBatch() in advanced.cpp. threads defaults to one per hardware thread.
+ * With --compat, maps are generated with the judger's sampler (see GenerateMines()).
+ * With --save-corpus, the maps are written to a corpus file (see corpus.h) instead of being played. --corpus plays
+ * every map of such a file once.
+ * With --rollout, the solver guesses with the rollout guesser (see rollout.h), sampling on the game's own thread.
+ * With --pipelined, every worker plays with a PipelinedPlayer (see harness.h), which runs the server side of the game
+ * on a second thread, and threads defaults to one per two hardware threads instead.
+ */
+int main(int argc, char *argv[]) {
+  bool compatible = false;
+  bool rollout = false;
+  bool pipelined = false;
+  const char *save_path = nullptr;
+  const char *corpus_path = nullptr;
+  std::vector<const char *> args;
+  for (int k = 1; k < argc; k++) {
+    if (std::strcmp(argv[k], "--compat") == 0) {
+      compatible = true;
+    } else if (std::strcmp(argv[k], "--rollout") == 0) {
+      rollout = true;
+    } else if (std::strcmp(argv[k], "--pipelined") == 0) {
+      pipelined = true;
+    } else if (std::strcmp(argv[k], "--save-corpus") == 0 && k + 1 < argc) {
+      save_path = argv[++k];
+    } else if (std::strcmp(argv[k], "--corpus") == 0 && k + 1 < argc) {
+      corpus_path = argv[++k];
+    } else {
+      args.push_back(argv[k]);
+    }
+  }
+  if (corpus_path == nullptr && args.size() < 6) {
+    std::fprintf(stderr,
+                 "Usage: %s rows columns mine_count seed min_dist games [threads] [--compat] [--rollout] "
+                 "[--pipelined] [--save-corpus file]\n"
+                 "       %s --corpus file [threads] [--rollout] [--pipelined]\n",
+                 argv[0], argv[0]);
+    return 1;
+  }
+  BatchConfig config;
+  config.rollout.enabled = rollout;
+  config.pipelined = pipelined;
+  Corpus corpus;
+  if (corpus_path != nullptr) {
+    if (!corpus.Open(corpus_path)) {
+      std::fprintf(stderr, "Invalid corpus file %s\n", corpus_path);
+      return 1;
+    }
+    config.corpus = &corpus;
+    config.games = static_cast<int64_t>(corpus.Size());
+    config.threads = args.size() > 0 ? std::atoi(args[0]) : 0;
+  } else {
+    config.rows = std::atoi(args[0]);
+    config.columns = std::atoi(args[1]);
+    config.mine_count = std::atoi(args[2]);
+    config.seed = std::strtoull(args[3], nullptr, 10);
+    config.min_dist = std::atoi(args[4]);
+    config.games = std::strtoll(args[5], nullptr, 10);
+    config.threads = args.size() > 6 ? std::atoi(args[6]) : 0;
+    config.compatible_maps = compatible;
+  }
+  if (pipelined && config.threads == 0) {
+    config.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency() / 2));
+  }
+
+  if (save_path != nullptr) {
+    if (!SaveCorpus(config, save_path)) {
+      std::fprintf(stderr, "Cannot write corpus file %s\n", save_path);
+      return 1;
+    }
+    std::printf("maps           %lld\n", static_cast<long long>(config.games));
+    return 0;
+  }
+
+  ThreadPool pool(config.threads);
+  BatchReport report = RunBatch(config, pool);
+
+  double games = static_cast<double>(report.games);
+  std::printf("games          %lld\n", static_cast<long long>(report.games));
+  std::printf("threads        %d\n", pool.Size());
+  std::printf("win rate       %.4f\n", report.wins / games);
+  std::printf("avg revealed   %.2f\n", report.visit_count / games);
+  std::printf("avg score      %.4f\n", report.score / games);
+  std::printf("games/sec      %.1f\n", games / report.seconds);
+  TRACE_DUMP();
+  return 0;
+}
@@ -0,0 +1,941 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "corpus.h"
+#include "game.h"
+#include "generator.h"
+#include "harness.h"
+#include "map_parser.h"
+#include "microbench.h"
+#include "solver.h"
+#include "wire.h"
+
+/**
+ * Benchmarks for the board engine, in two parts:
+ *   bench [--filter=regex] [--format=console|json|csv] [--min_time=seconds] [--list]
+ *       runs the microbenchmark suite (see microbench.h and RegisterSuite()) over several board sizes and mine
+ *       densities, with machine-readable output to track throughput from commit to commit;
+ *   bench --reports
+ *       runs the reports that compare each optimization with the code it replaced; every line reports the time per
+ *       block for one workload.
+ * The numbers are only meaningful when built with optimization (e.g. -DCMAKE_BUILD_TYPE=Release).
+ */
+
+namespace {
+
+/**
+ * The board layout used before Board existed: one bool plane per property, and the mine count recomputed from the
+ * mine plane whenever it is needed.
+ */
+struct LegacyBoard {
+  int rows = 0;
+  int columns = 0;
+  std::unique_ptr<bool[]> is_mine;
+  std::unique_ptr<bool[]> is_visited;
+  std::unique_ptr<bool[]> is_marked;
+
+  LegacyBoard(int rows, int columns)
+      : rows(rows),
+        columns(columns),
+        is_mine(new bool[static_cast<size_t>(rows) * columns]()),
+        is_visited(new bool[static_cast<size_t>(rows) * columns]()),
+        is_marked(new bool[static_cast<size_t>(rows) * columns]()) {}
+
+  size_t Index(int r, int c) const { return static_cast<size_t>(r) * columns + c; }
+
+  int CountAdjacentMines(int r, int c) const {
+    int count = 0;
+    for (int dr = -1; dr <= 1; dr++) {
+      for (int dc = -1; dc <= 1; dc++) {
+        if (dr == 0 && dc == 0) continue;
+        int nr = r + dr;
+        int nc = c + dc;
+        if (nr >= 0 && nr < rows && nc >= 0 && nc < columns && is_mine[Index(nr, nc)]) {
+          count++;
+        }
+      }
+    }
+    return count;
+  }
+};
+
+int CountAdjacentMines(const Board &board, int r, int c) {
+  int count = 0;
+  for (int dr = -1; dr <= 1; dr++) {
+    for (int dc = -1; dc <= 1; dc++) {
+      if (dr == 0 && dc == 0) continue;
+      int nr = r + dr;
+      int nc = c + dc;
+      if (nr >= 0 && nr < board.Rows() && nc >= 0 && nc < board.Columns() && board[nr][nc].mine) {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+// Every block is a mine with probability density, and about half of the safe blocks are visited.
+void Fill(LegacyBoard &legacy, Board &board, double density, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  for (int i = 0; i < board.Rows(); i++) {
+    for (int j = 0; j < board.Columns(); j++) {
+      bool mine = dist(rng) < density;
+      bool visited = !mine && dist(rng) < 0.5;
+      legacy.is_mine[legacy.Index(i, j)] = mine;
+      legacy.is_visited[legacy.Index(i, j)] = visited;
+      board[i][j].mine = mine;
+      board[i][j].visited = visited;
+    }
+  }
+  ComputeMineCounts(board);
+}
+
+// The per-block neighbour scan that InitMap used before ComputeMineCounts.
+void CountByNeighbourScan(Board &board) {
+  for (int i = 0; i < board.Rows(); i++) {
+    for (int j = 0; j < board.Columns(); j++) {
+      board[i][j].count = CountAdjacentMines(board, i, j);
+    }
+  }
+}
+
+// The same symbols PrintMap writes, rendered into frame instead of std::cout.
+char Symbol(bool mine, bool visited, bool marked, int count) {
+  if (visited) return mine ? 'X' : static_cast<char>('0' + count);
+  if (marked) return mine ? '@' : 'X';
+  return '?';
+}
+
+void RenderLegacy(const LegacyBoard &legacy, std::string &frame) {
+  size_t pos = 0;
+  for (int i = 0; i < legacy.rows; i++) {
+    for (int j = 0; j < legacy.columns; j++) {
+      size_t index = legacy.Index(i, j);
+      bool visited = legacy.is_visited[index];
+      int count = visited ? legacy.CountAdjacentMines(i, j) : 0;
+      frame[pos++] = Symbol(legacy.is_mine[index], visited, legacy.is_marked[index], count);
+    }
+    frame[pos++] = '\n';
+  }
+}
+
+void RenderBoard(const Board &board, std::string &frame) {
+  size_t pos = 0;
+  for (int i = 0; i < board.Rows(); i++) {
+    const Cell *row = board[i];
+    for (int j = 0; j < board.Columns(); j++) {
+      frame[pos++] = Symbol(row[j].mine, row[j].visited, row[j].marked, row[j].count);
+    }
+    frame[pos++] = '\n';
+  }
+}
+
+template <typename Function>
+double NanosecondsPerBlock(int rows, int columns, int repeats, Function function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < repeats; k++) {
+    function();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double blocks = static_cast<double>(rows) * columns * repeats;
+  return std::chrono::duration<double, std::nano>(end - start).count() / blocks;
+}
+
+void BenchLayout(int rows, int columns, int repeats) {
+  LegacyBoard legacy(rows, columns);
+  Board board(rows, columns);
+  Fill(legacy, board, 0.15, 42);
+  std::string frame(static_cast<size_t>(rows) * (columns + 1), ' ');
+
+  double legacy_ns = NanosecondsPerBlock(rows, columns, repeats, [&] { RenderLegacy(legacy, frame); });
+  double board_ns = NanosecondsPerBlock(rows, columns, repeats, [&] { RenderBoard(board, frame); });
+  size_t legacy_bytes = 3 * board.Size();
+  std::printf("layout/render %6dx%-6d legacy %7.2f ns/block  board %7.2f ns/block  speedup %5.2fx  "
+              "memory %zu -> %zu bytes\n",
+              rows, columns, legacy_ns, board_ns, legacy_ns / board_ns, legacy_bytes, board.Size());
+}
+
+void BenchCounts(int rows, int columns, int repeats) {
+  LegacyBoard legacy(rows, columns);
+  Board board(rows, columns);
+  Fill(legacy, board, 0.15, 42);
+
+  double scan_ns = NanosecondsPerBlock(rows, columns, repeats, [&] { CountByNeighbourScan(board); });
+  double kernel_ns = NanosecondsPerBlock(rows, columns, repeats, [&] { ComputeMineCounts(board); });
+  std::printf("counts/init   %6dx%-6d scan   %7.2f ns/block  window %6.2f ns/block  speedup %5.2fx\n", rows,
+              columns, scan_ns, kernel_ns, scan_ns / kernel_ns);
+}
+
+// The recursive flood fill that Game used before it kept its own work stack. Returns the number of safe blocks visited.
+int VisitBlockRecursive(Board &board, int r, int c) {
+  if (r < 0 || r >= board.Rows() || c < 0 || c >= board.Columns()) return 0;
+  if (board[r][c].visited || board[r][c].marked) return 0;
+  board[r][c].visited = true;
+  if (board[r][c].mine) return 0;
+  int visited = 1;
+  if (board[r][c].count == 0) {
+    for (int dr = -1; dr <= 1; dr++) {
+      for (int dc = -1; dc <= 1; dc++) {
+        if (dr == 0 && dc == 0) continue;
+        visited += VisitBlockRecursive(board, r + dr, c + dc);
+      }
+    }
+  }
+  return visited;
+}
+
+// Set up a game with mine_count random mines and return a block with mine count 0 to click on.
+std::pair<int, int> SetUpGame(Game &game, int rows, int columns, int mine_count, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  game.Reset(rows, columns);
+  for (int k = 0; k < mine_count; k++) {
+    game.PlaceMine(static_cast<int>(rng() % rows), static_cast<int>(rng() % columns));
+  }
+  game.Start();
+  while (true) {
+    int r = static_cast<int>(rng() % rows);
+    int c = static_cast<int>(rng() % columns);
+    if (!game.GetBoard()[r][c].mine && game.CountAdjacentMines(r, c) == 0) return {r, c};
+  }
+}
+
+struct FloodArgs {
+  Board *board;
+  int r;
+  int c;
+  int visited;
+  double seconds;
+};
+
+void *RunRecursiveFlood(void *data) {
+  auto *args = static_cast<FloodArgs *>(data);
+  auto start = std::chrono::steady_clock::now();
+  args->visited = VisitBlockRecursive(*args->board, args->r, args->c);
+  args->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return nullptr;
+}
+
+/**
+ * Flood a mostly empty board from one click with both fill strategies. The recursive fill goes as deep as the number of
+ * blocks it reveals, so it runs on a thread with a stack large enough for that; the default 8 MiB would overflow.
+ */
+void BenchFloodFill(int rows, int columns, int mine_count) {
+  Game game;
+  auto [r, c] = SetUpGame(game, rows, columns, mine_count, 42);
+  Board board = game.GetBoard();
+
+  FloodArgs args{&board, r, c, 0, -1.0};
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, static_cast<size_t>(2) << 30);
+  pthread_t thread;
+  if (pthread_create(&thread, &attr, RunRecursiveFlood, &args) == 0) {
+    pthread_join(thread, nullptr);
+  }
+  pthread_attr_destroy(&attr);
+
+  auto start = std::chrono::steady_clock::now();
+  game.VisitBlock(r, c);
+  double iterative_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  int visited = game.VisitCount();
+  if (args.seconds >= 0 && args.visited != visited) {
+    std::printf("flood fill mismatch: recursive %d, iterative %d\n", args.visited, visited);
+  }
+
+  std::printf("flood/open    %6dx%-6d mines %-5d revealed %-8d recursive %7.2f Mblocks/s  iterative %7.2f Mblocks/s\n",
+              rows, columns, mine_count, visited, args.visited / args.seconds / 1e6,
+              visited / iterative_seconds / 1e6);
+}
+
+// The generator before GenerateMines: list every available block and erase the chosen one from the middle.
+void GenerateMinesByErase(int rows, int columns, int mine_count, int min_dist, std::mt19937_64 &gen,
+                          std::vector<std::pair<int, int>> &mines) {
+  std::vector<std::pair<int, int>> available_block;
+  int row0 = Random(1, rows - 2, gen);
+  int col0 = Random(1, columns - 2, gen);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < columns; ++j) {
+      if (Dist(row0, col0, i, j) > min_dist) {
+        available_block.emplace_back(i, j);
+      }
+    }
+  }
+  mines.clear();
+  for (int i = 0; i < mine_count; ++i) {
+    auto mine_pos = Random(0, static_cast<int>(available_block.size()) - 1, gen);
+    mines.push_back(available_block[mine_pos]);
+    available_block.erase(available_block.begin() + mine_pos);
+  }
+}
+
+void BenchGenerator(int rows, int columns, int mine_count, int repeats) {
+  std::mt19937_64 gen(42);
+  std::vector<std::pair<int, int>> mines;
+  int row0, col0;
+  auto time_per_map = [&](auto generate) {
+    auto start = std::chrono::steady_clock::now();
+    for (int k = 0; k < repeats; k++) {
+      generate();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+  };
+  double erase_us = time_per_map([&] { GenerateMinesByErase(rows, columns, mine_count, 1, gen, mines); });
+  double compatible_us = time_per_map([&] { GenerateMines(rows, columns, mine_count, 1, gen, mines, row0, col0); });
+  double fast_us =
+      time_per_map([&] { GenerateMines(rows, columns, mine_count, 1, gen, mines, row0, col0, false); });
+  std::printf("generate      %6dx%-6d mines %-7d erase %10.1f us/map  compatible %8.1f us/map  fast %8.1f us/map\n",
+              rows, columns, mine_count, erase_us, compatible_us, fast_us);
+}
+
+}  // namespace
+
+// The pair pass of the solver before the bitboard layer: the neighbourhoods of both numbers are walked cell by cell
+// with bounds checks. Queues every cell it proves in planned and returns how many there are.
+size_t SolvePairsByScan(const Grid<char> &map, Grid<uint8_t> &planned) {
+  int rows = map.Rows();
+  int columns = map.Columns();
+  auto is_number = [&](int r, int c) { return map[r][c] >= '0' && map[r][c] <= '8'; };
+  auto count_adjacent = [&](int r, int c, int &unknown, int &marked) {
+    unknown = 0;
+    marked = 0;
+    for (int dr = -1; dr <= 1; dr++) {
+      for (int dc = -1; dc <= 1; dc++) {
+        if (dr == 0 && dc == 0) continue;
+        int nr = r + dr;
+        int nc = c + dc;
+        if (nr >= 0 && nr < rows && nc >= 0 && nc < columns) {
+          unknown += map[nr][nc] == '?';
+          marked += map[nr][nc] == '@';
+        }
+      }
+    }
+  };
+  size_t proven = 0;
+  auto plan_all = [&](const int (*cells)[2], int count) {
+    for (int k = 0; k < count; k++) {
+      if (!planned[cells[k][0]][cells[k][1]]) {
+        planned[cells[k][0]][cells[k][1]] = true;
+        proven++;
+      }
+    }
+  };
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      if (!is_number(i, j)) continue;
+      int unknown, marked;
+      count_adjacent(i, j, unknown, marked);
+      if (unknown == 0) continue;
+      for (int ni = i - 2; ni <= i + 2; ni++) {
+        for (int nj = j - 2; nj <= j + 2; nj++) {
+          if (ni < 0 || ni >= rows || nj < 0 || nj >= columns || (ni == i && nj == j) || !is_number(ni, nj)) continue;
+          int n_unknown, n_marked;
+          count_adjacent(ni, nj, n_unknown, n_marked);
+          if (n_unknown == 0) continue;
+          int unique_to_first[8][2];
+          int unique_to_second[8][2];
+          int common_count = 0, unique_first_count = 0, unique_second_count = 0;
+          for (int dr = -1; dr <= 1; dr++) {
+            for (int dc = -1; dc <= 1; dc++) {
+              if (dr == 0 && dc == 0) continue;
+              int r1 = i + dr, c1 = j + dc;
+              if (r1 >= 0 && r1 < rows && c1 >= 0 && c1 < columns && map[r1][c1] == '?') {
+                if (std::abs(r1 - ni) <= 1 && std::abs(c1 - nj) <= 1) {
+                  common_count++;
+                } else {
+                  unique_to_first[unique_first_count][0] = r1;
+                  unique_to_first[unique_first_count++][1] = c1;
+                }
+              }
+              int r2 = ni + dr, c2 = nj + dc;
+              if (r2 >= 0 && r2 < rows && c2 >= 0 && c2 < columns && map[r2][c2] == '?' &&
+                  (std::abs(r2 - i) > 1 || std::abs(c2 - j) > 1)) {
+                unique_to_second[unique_second_count][0] = r2;
+                unique_to_second[unique_second_count++][1] = c2;
+              }
+            }
+          }
+          int first = map[i][j] - '0' - marked;
+          int second = map[ni][nj] - '0' - n_marked;
+          if (unique_first_count == 0 && unique_second_count > 0) {
+            if (first == common_count || (first == 0 && second == unique_second_count)) {
+              plan_all(unique_to_second, unique_second_count);
+            }
+          }
+          if (unique_second_count == 0 && unique_first_count > 0) {
+            if (second == common_count || (second == 0 && first == unique_first_count)) {
+              plan_all(unique_to_first, unique_first_count);
+            }
+          }
+          if (unique_first_count > 0 && unique_second_count > 0 && common_count > 0 &&
+              (second - first == unique_second_count || first - second == unique_first_count)) {
+            plan_all(unique_to_first, unique_first_count);
+            plan_all(unique_to_second, unique_second_count);
+          }
+        }
+      }
+    }
+  }
+  return proven;
+}
+
+// Visit random safe blocks until about half of them are visited
+void VisitHalf(Game &game, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  int safe = game.Rows() * game.Columns() - game.TotalMines();
+  while (game.VisitCount() < safe / 2) {
+    int r = static_cast<int>(rng() % game.Rows());
+    int c = static_cast<int>(rng() % game.Columns());
+    if (!game.GetBoard()[r][c].mine) game.VisitBlock(r, c);
+  }
+}
+
+/**
+ * Run the pair reasoning over a whole mid-game map, where about half of the safe blocks have been visited, cell by
+ * cell and with the solver's bitboard windows.
+ */
+void BenchConstraintPass(int rows, int columns, int mine_count, int repeats) {
+  Game game;
+  SetUpGame(game, rows, columns, mine_count, 42);
+  VisitHalf(game, 7);
+  Grid<char> map(rows, columns, '?');
+  Solver solver;
+  solver.Reset(rows, columns, game.TotalMines());
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      map[i][j] = game.Symbol(i, j);
+      solver.UpdateBlock(i, j, map[i][j]);
+    }
+  }
+
+  Grid<uint8_t> planned(rows, columns, false);
+  size_t scan_proven = 0, bitboard_proven = 0;
+  double scan_ns = NanosecondsPerBlock(rows, columns, repeats, [&] {
+    planned.Fill(false);
+    scan_proven = SolvePairsByScan(map, planned);
+  });
+  double bitboard_ns = NanosecondsPerBlock(rows, columns, repeats, [&] { bitboard_proven = solver.SolveAllPairs(); });
+  if (scan_proven != bitboard_proven) {
+    std::printf("constraint pass mismatch: scan %zu, bitboard %zu\n", scan_proven, bitboard_proven);
+  }
+  std::printf("solver/pairs  %6dx%-6d scan   %7.2f ns/block  bitboard %5.2f ns/block  speedup %5.2fx  proven %zu\n",
+              rows, columns, scan_ns, bitboard_ns, scan_ns / bitboard_ns, bitboard_proven);
+}
+
+/**
+ * Serve one game over the text protocol of basic.cpp and over the binary protocol of wire.h, writing the frames to
+ * /dev/null. The commands visit every safe block in random order, so the game ends with a win after one move per safe
+ * block, and the input is ready in full, as it is for a harness that sends its commands ahead.
+ */
+void BenchProtocol(int rows, int columns, int mine_count) {
+  Game game;
+  SetUpGame(game, rows, columns, mine_count, 42);
+  std::vector<WireCommand> commands;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      if (!game.GetBoard()[i][j].mine) commands.push_back({i, j, 0});
+    }
+  }
+  std::shuffle(commands.begin(), commands.end(), std::mt19937_64(7));
+  std::vector<uint8_t> mine_bits((static_cast<size_t>(rows) * columns + 7) / 8, 0);
+  std::string text_map = std::to_string(rows) + ' ' + std::to_string(columns) + '\n';
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      size_t k = static_cast<size_t>(i) * columns + j;
+      bool mine = game.GetBoard()[i][j].mine;
+      if (mine) mine_bits[k >> 3] |= static_cast<uint8_t>(1 << (k & 7));
+      text_map += mine ? 'X' : '.';
+    }
+    text_map += '\n';
+  }
+
+  std::string text_input = text_map;
+  for (const WireCommand &command : commands) {
+    text_input += std::to_string(command.row) + ' ' + std::to_string(command.column) + " 0\n";
+  }
+  std::ofstream null_stream("/dev/null");
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::istringstream in(text_input);
+    int n, m;
+    in >> n >> m;
+    game.Read(n, m, in);
+    game.PrintMap(null_stream);
+    int x, y, type;
+    while (game.State() == 0 && in >> x >> y >> type) {
+      game.Apply(x, y, type);
+      game.PrintMap(null_stream);
+    }
+  }
+  double text_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // The binary input goes through a file, so that the reader sees a real descriptor
+  FILE *file = std::tmpfile();
+  WireMapHeader header{rows, columns};
+  std::fwrite(&header, sizeof(header), 1, file);
+  std::fwrite(mine_bits.data(), 1, mine_bits.size(), file);
+  std::fwrite(commands.data(), sizeof(WireCommand), commands.size(), file);
+  std::fflush(file);
+  int null_fd = open("/dev/null", O_WRONLY);
+  double binary_seconds[2];
+  for (int k = 0; k < 2; k++) {
+    lseek(fileno(file), 0, SEEK_SET);
+    FdReader in(fileno(file));
+    FdWriter out(null_fd);
+    start = std::chrono::steady_clock::now();
+    ServeBinary(game, in, out, k == 0 ? kPacked : kRunLength);
+    binary_seconds[k] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  close(null_fd);
+  std::fclose(file);
+
+  double moves = static_cast<double>(commands.size());
+  std::printf("protocol      %6dx%-6d text %9.0f moves/s  packed %9.0f moves/s (%5.1fx)  rle %9.0f moves/s (%5.1fx)\n",
+              rows, columns, moves / text_seconds, moves / binary_seconds[0], text_seconds / binary_seconds[0],
+              moves / binary_seconds[1], text_seconds / binary_seconds[1]);
+}
+
+/**
+ * Load a rows * columns map from a file in the format GenerateMap() writes, the way InitMap() used to (one `>> c` per
+ * block), through the row parser behind Game::Read(), and from a memory mapping of the file. The times cover parsing
+ * and placing the mines; Game::Start(), which is the same for all three, is reported on its own.
+ */
+void BenchMapParser(int rows, int columns) {
+  char path[] = "/tmp/bench_map_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return;
+  {
+    std::mt19937_64 rng(42);
+    std::string text = std::to_string(rows) + "  " + std::to_string(columns) + '\n';
+    std::string line(static_cast<size_t>(columns) + 1, '\n');
+    FILE *file = fdopen(dup(fd), "w");
+    std::fputs(text.c_str(), file);
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < columns; j++) {
+        line[j] = rng() % 100 < 15 ? 'X' : '.';
+      }
+      std::fwrite(line.data(), 1, line.size(), file);
+    }
+    std::fclose(file);
+  }
+
+  Game game;
+  int mines[3];
+  double seconds[3];
+  double start_seconds = 0.0;
+  for (int k = 0; k < 3; k++) {
+    auto start = std::chrono::steady_clock::now();
+    if (k == 0) {
+      std::ifstream in(path);
+      int n, m;
+      in >> n >> m;
+      game.Reset(n, m);
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+          char c;
+          in >> c;
+          if (c == 'X') game.PlaceMine(i, j);
+        }
+      }
+    } else if (k == 1) {
+      std::ifstream in(path);
+      int n, m;
+      in >> n >> m;
+      game.Reset(n, m);
+      std::string row(m, '.');
+      for (int i = 0; i < n; i++) {
+        ReadMapRow(in, &row[0], m);
+        game.LoadRow(i, row.data());
+      }
+    } else {
+      // As InitMapFromFile() does, a map that cannot be mapped or parsed fails the benchmark
+      MappedFile file;
+      int n, m;
+      bool parsed = file.Open(fd);
+      const char *cursor = file.Data();
+      const char *end = file.Data() + file.Size();
+      parsed = parsed && ParseInt(cursor, end, n) && ParseInt(cursor, end, m);
+      if (parsed) {
+        game.Reset(n, m);
+        std::string scratch;
+        for (int i = 0; i < n && parsed; i++) {
+          const char *row = ParseMapRow(cursor, end, m, scratch);
+          parsed = row != nullptr;
+          if (parsed) game.LoadRow(i, row);
+        }
+      }
+      if (!parsed) {
+        std::printf("map parser: cannot parse the mapped file %s\n", path);
+        close(fd);
+        unlink(path);
+        return;
+      }
+    }
+    auto parsed = std::chrono::steady_clock::now();
+    game.Start();
+    seconds[k] = std::chrono::duration<double>(parsed - start).count();
+    start_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed).count();
+    mines[k] = game.TotalMines();
+  }
+  close(fd);
+  unlink(path);
+  if (mines[0] != mines[1] || mines[0] != mines[2]) {
+    std::printf("map parser mismatch: %d %d %d mines\n", mines[0], mines[1], mines[2]);
+  }
+  std::printf("parse/map     %6dx%-6d >> c %9.2f ms  rows %8.2f ms  mmap %8.2f ms  speedup %5.1fx / %5.1fx  "
+              "Start() %.2f ms\n",
+              rows, columns, seconds[0] * 1e3, seconds[1] * 1e3, seconds[2] * 1e3, seconds[0] / seconds[1],
+              seconds[0] / seconds[2], start_seconds * 1e3);
+}
+
+/**
+ * Start maps games on rows * columns maps: generated and passed as text, the way TestBatch() does, or replayed from a
+ * corpus file.
+ */
+void BenchCorpus(int rows, int columns, int mine_count, int maps) {
+  char path[] = "/tmp/bench_corpus_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) return;
+  close(fd);
+  {
+    CorpusWriter writer;
+    writer.Open(path);
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<int, int>> mines;
+    for (int k = 0; k < maps; k++) {
+      int row0, col0;
+      GenerateMines(rows, columns, mine_count, 1, rng, mines, row0, col0, false);
+      writer.Add(rows, columns, row0, col0, mines);
+    }
+    writer.Finish();
+  }
+
+  Game game;
+  int64_t text_mines = 0, corpus_mines = 0;
+  InitSeed(42);
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < maps; k++) {
+    std::ostringstream out;
+    std::streambuf *old_buffer = std::cout.rdbuf(out.rdbuf());
+    GenerateMap(rows, columns, mine_count, 1);
+    std::cout.rdbuf(old_buffer);
+    std::istringstream in(out.str());
+    int n, m;
+    in >> n >> m;
+    game.Read(n, m, in);
+    text_mines += game.TotalMines();
+  }
+  double text_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Corpus corpus;
+  start = std::chrono::steady_clock::now();
+  corpus.Open(path);
+  for (size_t k = 0; k < corpus.Size(); k++) {
+    corpus.Load(k, game);
+    corpus_mines += game.TotalMines();
+  }
+  double corpus_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  unlink(path);
+  if (text_mines != corpus_mines) {
+    std::printf("corpus mismatch: %lld and %lld mines\n", static_cast<long long>(text_mines),
+                static_cast<long long>(corpus_mines));
+  }
+  std::printf("corpus/start  %6dx%-6d text %9.2f us/map  corpus %7.2f us/map  speedup %5.1fx\n", rows, columns,
+              text_seconds / maps * 1e6, corpus_seconds / maps * 1e6, text_seconds / corpus_seconds);
+}
+
+/**
+ * Try a visit on every unknown block of a mid-game map and take it back, either by playing it on a copy of the game
+ * or by rolling back to a checkpoint.
+ */
+void BenchCheckpoint(int rows, int columns, int mine_count) {
+  Game game;
+  SetUpGame(game, rows, columns, mine_count, 42);
+  VisitHalf(game, 7);
+  game.CollectDirtyBlocks();
+  std::vector<std::pair<int, int>> candidates;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      if (game.Symbol(i, j) == '?') candidates.emplace_back(i, j);
+    }
+  }
+  if (candidates.size() > 2000) candidates.resize(2000);
+
+  int64_t copy_visits = 0, rollback_visits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto [r, c] : candidates) {
+    Game branch = game;
+    branch.VisitBlock(r, c);
+    copy_visits += branch.VisitCount();
+  }
+  double copy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  for (auto [r, c] : candidates) {
+    GameCheckpoint checkpoint = game.Checkpoint();
+    game.VisitBlock(r, c);
+    rollback_visits += game.VisitCount();
+    game.Rollback(checkpoint);
+  }
+  double rollback_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (copy_visits != rollback_visits) {
+    std::printf("checkpoint mismatch: %lld and %lld visits\n", static_cast<long long>(copy_visits),
+                static_cast<long long>(rollback_visits));
+  }
+  double branches = static_cast<double>(candidates.size());
+  std::printf("branch/visit  %6dx%-6d copy %9.2f us/branch  rollback %7.3f us/branch  speedup %7.1fx\n", rows,
+              columns, copy_seconds / branches * 1e6, rollback_seconds / branches * 1e6,
+              copy_seconds / rollback_seconds);
+}
+
+/**
+ * Play games with the rollout guesser on threads sampling threads (0 for all) and report how fast it samples boards
+ * while guessing. Every guess samples the same boards whatever the thread count, so only the speed should differ.
+ */
+void BenchRollout(int rows, int columns, int mine_count, int games, int threads) {
+  RolloutConfig config;
+  config.enabled = true;
+  config.threads = threads;
+  Game game;
+  Solver solver;
+  solver.SetRollout(config);
+  int wins = 0;
+  for (int k = 0; k < games; k++) {
+    std::mt19937_64 rng(GameSeed(42, static_cast<uint64_t>(k)));
+    std::vector<std::pair<int, int>> mines;
+    int row0, col0;
+    GenerateMines(rows, columns, mine_count, 1, rng, mines, row0, col0, false);
+    game.Reset(rows, columns);
+    for (auto [r, c] : mines) {
+      game.PlaceMine(r, c);
+    }
+    game.Start();
+    wins += PlayGame(game, solver, row0, col0).won;
+  }
+  const RolloutGuesser &rollout = solver.Rollout();
+  std::printf("rollout       %6dx%-6d %2d threads  %9.0f boards/s  %5.1f ms/game sampling  %d/%d won\n", rows, columns,
+              threads == 0 ? static_cast<int>(std::thread::hardware_concurrency()) : threads,
+              static_cast<double>(rollout.TotalSamples()) / rollout.TotalSeconds(),
+              rollout.TotalSeconds() / games * 1e3, wins, games);
+}
+
+// A stream buffer that copies everything written to it into a small scratch area and drops it, as writing to a pipe
+// would cost without the system calls
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return traits_type::not_eof(c); }
+  std::streamsize xsputn(const char *data, std::streamsize count) override {
+    for (std::streamsize done = 0; done < count; done += sizeof(scratch_)) {
+      size_t size = std::min(sizeof(scratch_), static_cast<size_t>(count - done));
+      std::memcpy(scratch_, data + done, size);
+      DoNotOptimize(scratch_);
+    }
+    return count;
+  }
+
+ private:
+  char scratch_[1 << 16];
+};
+
+// The arguments of every benchmark of the suite: the board, and the number of mines on it
+const std::vector<std::string> kBoardArgs = {"rows", "columns", "mines"};
+
+void SuiteCountAdjacentMines(BenchmarkState &state) {
+  int rows = static_cast<int>(state.Range(0));
+  int columns = static_cast<int>(state.Range(1));
+  Game game;
+  SetUpGame(game, rows, columns, static_cast<int>(state.Range(2)), 42);
+  int64_t total = 0;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < columns; j++) {
+        total += game.CountAdjacentMines(i, j);
+      }
+    }
+    DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.Iterations() * rows * columns);
+}
+
+// Click a block with mine count 0 and take the click back. Items are the blocks revealed.
+void SuiteVisitBlock(BenchmarkState &state) {
+  Game game;
+  auto [r, c] = SetUpGame(game, static_cast<int>(state.Range(0)), static_cast<int>(state.Range(1)),
+                          static_cast<int>(state.Range(2)), 42);
+  GameCheckpoint start = game.Checkpoint();
+  int64_t revealed = 0;
+  while (state.KeepRunning()) {
+    game.VisitBlock(r, c);
+    revealed += game.VisitCount();
+    game.Rollback(start);
+  }
+  state.SetItemsProcessed(revealed);
+  state.SetLabel("revealed " + std::to_string(revealed / state.Iterations()));
+}
+
+// Write the map of a game where half of the safe blocks are visited
+void SuitePrintMap(BenchmarkState &state) {
+  int rows = static_cast<int>(state.Range(0));
+  int columns = static_cast<int>(state.Range(1));
+  Game game;
+  SetUpGame(game, rows, columns, static_cast<int>(state.Range(2)), 42);
+  VisitHalf(game, 7);
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+  while (state.KeepRunning()) {
+    game.PrintMap(out);
+  }
+  state.SetBytesProcessed(state.Iterations() * rows * (columns + 1));
+}
+
+void SuiteGenerateMap(BenchmarkState &state) {
+  int rows = static_cast<int>(state.Range(0));
+  int columns = static_cast<int>(state.Range(1));
+  int mine_count = static_cast<int>(state.Range(2));
+  NullBuffer buffer;
+  std::streambuf *old_buffer = std::cout.rdbuf(&buffer);
+  InitSeed(42);
+  while (state.KeepRunning()) {
+    GenerateMap(rows, columns, mine_count, 1);
+  }
+  std::cout.rdbuf(old_buffer);
+  state.SetItemsProcessed(state.Iterations());
+  state.SetBytesProcessed(state.Iterations() * rows * (columns + 1));
+}
+
+// Read the text map of a game where half of the safe blocks are visited into a solver, as ReadMap() does on every
+// move. The solver already knows the map, as it would after the previous move, so this is the parsing and the scan.
+void SuiteReadMap(BenchmarkState &state) {
+  int rows = static_cast<int>(state.Range(0));
+  int columns = static_cast<int>(state.Range(1));
+  Game game;
+  SetUpGame(game, rows, columns, static_cast<int>(state.Range(2)), 42);
+  VisitHalf(game, 7);
+  std::ostringstream text;
+  game.PrintMap(text);
+  Solver solver;
+  solver.Reset(rows, columns, game.TotalMines());
+  std::stringbuf buffer(text.str(), std::ios::in);
+  std::istream in(&buffer);
+  std::string row(columns, ' ');
+  while (state.KeepRunning()) {
+    buffer.pubseekpos(0, std::ios::in);
+    in.clear();
+    for (int i = 0; i < rows; i++) {
+      if (!ReadMapRow(in, &row[0], columns)) break;
+      for (int j = 0; j < columns; j++) {
+        solver.UpdateBlock(i, j, row[j]);
+      }
+    }
+  }
+  state.SetBytesProcessed(state.Iterations() * static_cast<int64_t>(text.str().size()));
+}
+
+// Play whole games on generated maps with the client's solver. Items are games.
+void SuiteDecideLoop(BenchmarkState &state) {
+  int rows = static_cast<int>(state.Range(0));
+  int columns = static_cast<int>(state.Range(1));
+  int mine_count = static_cast<int>(state.Range(2));
+  Game game;
+  Solver solver;
+  std::vector<std::pair<int, int>> mines;
+  int64_t games = 0, wins = 0;
+  while (state.KeepRunning()) {
+    std::mt19937_64 rng(GameSeed(42, static_cast<uint64_t>(games++)));
+    int row0, col0;
+    GenerateMines(rows, columns, mine_count, 1, rng, mines, row0, col0, false);
+    game.Reset(rows, columns);
+    for (auto [r, c] : mines) {
+      game.PlaceMine(r, c);
+    }
+    game.Start();
+    wins += PlayGame(game, solver, row0, col0).won;
+  }
+  state.SetItemsProcessed(games);
+  state.SetLabel("won " + std::to_string(wins) + "/" + std::to_string(games));
+}
+
+void RegisterSuite(BenchmarkRunner &runner) {
+  runner.Register("CountAdjacentMines", SuiteCountAdjacentMines)
+      .ArgNames(kBoardArgs)
+      .Args({30, 30, 150})
+      .Args({1000, 1000, 50000})
+      .Args({1000, 1000, 150000})
+      .Args({1000, 1000, 250000});
+  // Open boards reveal large areas from one click; dense ones a few blocks
+  runner.Register("VisitBlock", SuiteVisitBlock)
+      .ArgNames(kBoardArgs)
+      .Args({30, 30, 10})
+      .Args({30, 30, 180})
+      .Args({1000, 1000, 10000})
+      .Args({1000, 1000, 200000});
+  runner.Register("PrintMap", SuitePrintMap)
+      .ArgNames(kBoardArgs)
+      .Args({30, 30, 150})
+      .Args({1000, 1000, 150000});
+  runner.Register("GenerateMap", SuiteGenerateMap)
+      .ArgNames(kBoardArgs)
+      .Args({30, 30, 150})
+      .Args({1000, 1000, 150000});
+  runner.Register("ReadMap", SuiteReadMap)
+      .ArgNames(kBoardArgs)
+      .Args({30, 30, 150})
+      .Args({1000, 1000, 150000});
+  runner.Register("DecideLoop", SuiteDecideLoop)
+      .ArgNames(kBoardArgs)
+      .Args({9, 9, 10})
+      .Args({16, 30, 99})
+      .Args({30, 30, 150});
+}
+
+// The comparisons of every optimization with the code it replaced
+void RunReports() {
+  BenchLayout(30, 30, 20000);
+  BenchLayout(1000, 1000, 20);
+  BenchLayout(10000, 10000, 1);
+  BenchCounts(30, 30, 20000);
+  BenchCounts(1000, 1000, 20);
+  BenchCounts(10000, 10000, 1);
+  BenchFloodFill(2000, 2000, 40);
+  BenchGenerator(30, 30, 150, 2000);
+  BenchGenerator(300, 300, 13500, 5);
+  BenchGenerator(3000, 3000, 150, 1);
+  BenchConstraintPass(30, 30, 150, 2000);
+  BenchConstraintPass(512, 512, 45000, 10);
+  BenchProtocol(30, 30, 150);
+  BenchProtocol(200, 200, 6000);
+  BenchMapParser(1000, 1000);
+  BenchMapParser(10000, 10000);
+  BenchCorpus(30, 30, 150, 20000);
+  BenchCorpus(300, 300, 13500, 200);
+  BenchCheckpoint(30, 30, 150);
+  BenchCheckpoint(1000, 1000, 150000);
+  BenchRollout(30, 30, 150, 50, 1);
+  BenchRollout(30, 30, 150, 50, 0);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && std::strcmp(argv[1], "--reports") == 0) {
+    RunReports();
+    return 0;
+  }
+  BenchmarkRunner runner;
+  RegisterSuite(runner);
+  return runner.Run(argc, argv);
+}
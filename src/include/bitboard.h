@@ -0,0 +1,159 @@
+/**
+ * This header file holds the bitboard layer of the solver: one bit per block, 64 blocks per word, so that a
+ * neighbourhood can be read, intersected and counted with a few word operations instead of a loop over cells.
+ */
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+
+/**
+ * @brief A rows * columns set of blocks, stored as one bitset per row
+ *
+ * @details Every row is surrounded by kMargin zero bits on both sides and the grid by kMargin zero rows above and
+ * below, so reading a window that hangs over the border needs no bounds checks: the blocks outside the map read as 0.
+ */
+class BitGrid {
+ public:
+  static constexpr int kMargin = 3;
+  // Side of the window Window() reads: a block, its neighbours and their neighbours' neighbours
+  static constexpr int kWindow = 2 * kMargin + 1;
+
+  void Resize(int rows, int columns);
+  void Clear() { words_.assign(words_.size(), 0); }
+
+  void Set(int r, int c) { Word(r, c) |= Bit(c); }
+  void Reset(int r, int c) { Word(r, c) &= ~Bit(c); }
+  bool Test(int r, int c) const { return (Word(r, c) & Bit(c)) != 0; }
+
+  /**
+   * @brief The kWindow * kWindow blocks centred on (r, c), as a 49-bit mask
+   * @details Bit (dr + kMargin) * kWindow + (dc + kMargin) is block (r + dr, c + dc). The window is assembled from
+   * seven shifted row reads, and the masks of WindowMasks select neighbourhoods inside it.
+   */
+  uint64_t Window(int r, int c) const;
+
+  /**
+   * @brief Store in counts the number of neighbours in this set of every block
+   * @details The 8 neighbour planes of a word of 64 blocks are summed with a bit-sliced adder, so one pass over a
+   * row counts 64 blocks at a time.
+   */
+  void CountNeighbours(Grid<uint8_t> &counts) const;
+
+  int Rows() const { return rows_; }
+  int Columns() const { return columns_; }
+
+ private:
+  uint64_t Bit(int c) const { return uint64_t{1} << ((c + kMargin) & 63); }
+  uint64_t &Word(int r, int c) { return words_[RowOffset(r) + ((c + kMargin) >> 6)]; }
+  const uint64_t &Word(int r, int c) const { return words_[RowOffset(r) + ((c + kMargin) >> 6)]; }
+  size_t RowOffset(int r) const { return static_cast<size_t>(r + kMargin) * words_per_row_; }
+  // The bits of columns [c, c + 64) of row r, shifted down to bit 0. c may be negative down to -kMargin.
+  uint64_t Read(int r, int c) const;
+
+  int rows_ = 0;
+  int columns_ = 0;
+  int words_per_row_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+// Masks over a BitGrid::Window()
+struct WindowMasks {
+  // neighbours[(dr + 2) * 5 + (dc + 2)] holds the 8 neighbours of the block at offset (dr, dc) from the centre
+  std::array<uint64_t, 25> neighbours;
+  // The 5 * 5 blocks around the centre: every block whose neighbourhood overlaps the centre's
+  uint64_t pairs;
+};
+
+constexpr int WindowBit(int dr, int dc) { return (dr + BitGrid::kMargin) * BitGrid::kWindow + dc + BitGrid::kMargin; }
+
+constexpr WindowMasks MakeWindowMasks() {
+  WindowMasks masks{};
+  for (int dr = -2; dr <= 2; dr++) {
+    for (int dc = -2; dc <= 2; dc++) {
+      uint64_t mask = 0;
+      for (int er = -1; er <= 1; er++) {
+        for (int ec = -1; ec <= 1; ec++) {
+          if (er == 0 && ec == 0) continue;
+          mask |= uint64_t{1} << WindowBit(dr + er, dc + ec);
+        }
+      }
+      masks.neighbours[(dr + 2) * 5 + dc + 2] = mask;
+      masks.pairs |= uint64_t{1} << WindowBit(dr, dc);
+    }
+  }
+  return masks;
+}
+
+inline constexpr WindowMasks kWindowMasks = MakeWindowMasks();
+
+// The 8 neighbours of the block at window bit `bit`, which must lie in the 5 * 5 square of WindowMasks::pairs
+inline uint64_t NeighbourMask(int bit) {
+  int dr = bit / BitGrid::kWindow - BitGrid::kMargin;
+  int dc = bit % BitGrid::kWindow - BitGrid::kMargin;
+  return kWindowMasks.neighbours[(dr + 2) * 5 + dc + 2];
+}
+
+inline void BitGrid::Resize(int rows, int columns) {
+  rows_ = rows;
+  columns_ = columns;
+  // One spare word per row, so that Read() can always load the word after the one it starts in
+  words_per_row_ = (columns + 2 * kMargin + 63) / 64 + 1;
+  words_.assign(static_cast<size_t>(rows + 2 * kMargin) * words_per_row_, 0);
+}
+
+inline uint64_t BitGrid::Read(int r, int c) const {
+  size_t index = RowOffset(r) + ((c + kMargin) >> 6);
+  int shift = (c + kMargin) & 63;
+  uint64_t bits = words_[index] >> shift;
+  if (shift != 0) {
+    bits |= words_[index + 1] << (64 - shift);
+  }
+  return bits;
+}
+
+inline uint64_t BitGrid::Window(int r, int c) const {
+  constexpr uint64_t kRowMask = (uint64_t{1} << kWindow) - 1;
+  uint64_t window = 0;
+  for (int dr = -kMargin; dr <= kMargin; dr++) {
+    window |= (Read(r + dr, c - kMargin) & kRowMask) << ((dr + kMargin) * kWindow);
+  }
+  return window;
+}
+
+inline void BitGrid::CountNeighbours(Grid<uint8_t> &counts) const {
+  // A grid of the right size keeps its border, if it has one
+  if (counts.Rows() != rows_ || counts.Columns() != columns_) counts.Resize(rows_, columns_, 0);
+  for (int i = 0; i < rows_; i++) {
+    uint8_t *out = counts[i];
+    for (int j = 0; j < columns_; j += 64) {
+      // The 8 neighbour planes of blocks [j, j + 64): the rows above and below at offsets -1, 0, 1 and the row itself
+      // at offsets -1 and 1
+      uint64_t planes[8] = {Read(i - 1, j - 1), Read(i - 1, j), Read(i - 1, j + 1), Read(i, j - 1),
+                            Read(i, j + 1),     Read(i + 1, j - 1), Read(i + 1, j), Read(i + 1, j + 1)};
+      // Bit-sliced sum: bit k of b0, b1, b2, b3 are the binary digits of the count of block j + k
+      uint64_t b0 = 0, b1 = 0, b2 = 0, b3 = 0;
+      for (uint64_t plane : planes) {
+        uint64_t carry0 = b0 & plane;
+        b0 ^= plane;
+        uint64_t carry1 = b1 & carry0;
+        b1 ^= carry0;
+        uint64_t carry2 = b2 & carry1;
+        b2 ^= carry1;
+        b3 |= carry2;
+      }
+      int end = columns_ - j < 64 ? columns_ - j : 64;
+      for (int k = 0; k < end; k++) {
+        out[j + k] = static_cast<uint8_t>(((b0 >> k) & 1) | (((b1 >> k) & 1) << 1) | (((b2 >> k) & 1) << 2) |
+                                          (((b3 >> k) & 1) << 3));
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * This header file provides the storage shared by the server, the client and the tools around them.
+ * A board used to be a fixed-size `[35][35]` array; here it is a dense grid whose size is chosen at run time.
+ */
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The eight neighbours of a block as row and column deltas, in row-major order. Neighbour loops walk these tables
+// instead of two nested loops; the offsets of the same neighbours in a grid are Grid::Neighbours().
+constexpr int kNeighbourRows[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+constexpr int kNeighbourColumns[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+/**
+ * @brief A row-major 2D grid stored in one contiguous buffer.
+ *
+ * @details grid[r][c] works exactly like the old fixed-size arrays did, so neighbour loops keep their shape, but the
+ * dimensions are only limited by memory. Resizing keeps the allocated capacity, which means a grid can be reused for
+ * many games without reallocating.
+ *
+ * A grid sized with ResizeBordered() also has a border of one sentinel cell all around: grid[-1][c], grid[rows][c],
+ * grid[r][-1] and grid[r][columns] are valid, so a neighbour loop needs no bounds checks as long as the sentinel
+ * value makes it skip the border. Data() and Size() then cover the border as well.
+ *
+ * @note T should not be bool, since std::vector<bool> is not contiguous. Use uint8_t instead.
+ */
+template <typename T>
+class Grid {
+ public:
+  Grid() = default;
+  Grid(int rows, int columns, const T &value = T()) { Resize(rows, columns, value); }
+
+  // Change the dimensions and fill every cell with value.
+  void Resize(int rows, int columns, const T &value = T()) { Allocate(rows, columns, 0, value, value); }
+  // Change the dimensions, fill every cell with value and the border around them with sentinel
+  void ResizeBordered(int rows, int columns, const T &value, const T &sentinel) {
+    Allocate(rows, columns, 1, value, sentinel);
+  }
+
+  void Fill(const T &value) { data_.assign(data_.size(), value); }
+
+  int Rows() const { return rows_; }
+  int Columns() const { return columns_; }
+  size_t Size() const { return data_.size(); }
+  // Distance between vertically adjacent cells, and the position of (r, c) relative to Data()
+  int Stride() const { return stride_; }
+  ptrdiff_t Offset(int r, int c) const { return origin_ + static_cast<ptrdiff_t>(r) * stride_ + c; }
+  // Offsets of the eight neighbours of a cell relative to it, in the order of kNeighbourRows and kNeighbourColumns
+  const int *Neighbours() const { return neighbours_; }
+
+  T *Data() { return data_.data(); }
+  const T *Data() const { return data_.data(); }
+
+  T *operator[](int r) { return data_.data() + origin_ + static_cast<ptrdiff_t>(r) * stride_; }
+  const T *operator[](int r) const { return data_.data() + origin_ + static_cast<ptrdiff_t>(r) * stride_; }
+
+ private:
+  void Allocate(int rows, int columns, int border, const T &value, const T &sentinel) {
+    rows_ = rows;
+    columns_ = columns;
+    stride_ = columns + 2 * border;
+    origin_ = static_cast<ptrdiff_t>(border) * stride_ + border;
+    for (int k = 0; k < 8; k++) {
+      neighbours_[k] = kNeighbourRows[k] * stride_ + kNeighbourColumns[k];
+    }
+    if (border == 0) {
+      data_.assign(static_cast<size_t>(rows) * columns, value);
+      return;
+    }
+    data_.assign(static_cast<size_t>(rows + 2) * stride_, sentinel);
+    for (int i = 0; i < rows; i++) {
+      std::fill((*this)[i], (*this)[i] + columns, value);
+    }
+  }
+
+  int rows_ = 0;
+  int columns_ = 0;
+  int stride_ = 0;
+  ptrdiff_t origin_ = 0;  // Offset of (0, 0)
+  int neighbours_[8] = {};
+  std::vector<T> data_;
+};
+
+/**
+ * @brief The server-side state of one block, packed into a single byte.
+ *
+ * @details Everything the server needs to know about a block sits in the same byte, so a visit, a mark or a render
+ * touches one cache line per 64 blocks instead of one per plane.
+ */
+struct Cell {
+  uint8_t mine : 1;     // True if the block contains a mine
+  uint8_t visited : 1;  // True if the block has been visited
+  uint8_t marked : 1;   // True if the block has been marked as a mine
+  uint8_t count : 4;    // The number of adjacent mines, cached when the map is loaded
+  uint8_t dirty : 1;    // Scratch of Game::CollectDirtyBlocks(): true while the block is on the dirty list
+};
+
+static_assert(sizeof(Cell) == 1, "Cell must stay packed into one byte");
+
+// The border of a Board: no mine, and already visited, so that neither the flood fill nor AutoExplore() steps onto it
+constexpr Cell kBorderCell = {0, 1, 0, 0, 0};
+
+using Board = Grid<Cell>;
+
+/**
+ * @brief Fill the count field of every block on the board from its mine bits.
+ *
+ * @details Instead of looking at 8 neighbours per block, the kernel slides a window down the rows: for every row it
+ * sums the mine bits of the rows above, at and below each column into a vertical strip, and then adds three adjacent
+ * strips together. Each block costs a handful of additions with no bounds checks, independent of the mine density.
+ */
+inline void ComputeMineCounts(Board &board) {
+  int rows = board.Rows();
+  int columns = board.Columns();
+  // strip[j + 1] holds the mines in column j of the current three rows; strip[0] and strip[columns + 1] stay 0
+  std::vector<uint8_t> strip(columns + 2, 0);
+  for (int i = 0; i < rows; i++) {
+    const Cell *above = i > 0 ? board[i - 1] : nullptr;
+    const Cell *below = i + 1 < rows ? board[i + 1] : nullptr;
+    Cell *row = board[i];
+    for (int j = 0; j < columns; j++) {
+      strip[j + 1] = row[j].mine + (above ? above[j].mine : 0) + (below ? below[j].mine : 0);
+    }
+    for (int j = 0; j < columns; j++) {
+      row[j].count = strip[j] + strip[j + 1] + strip[j + 2] - row[j].mine;
+    }
+  }
+}
+
+#endif
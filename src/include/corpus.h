@@ -0,0 +1,224 @@
+/**
+ * This header file holds the map corpus: a binary file of many fixed maps that the server and the batch harness read
+ * through a memory mapping, so that replaying a map costs no generation and no parsing. All the fields are
+ * little-endian and every record starts at a multiple of 8 bytes.
+ *
+ *     CorpusHeader                     magic, version, map count and the offset of the index
+ *     CorpusMapHeader + mine bitset    one per map: dimensions, first step, mine count, then (rows * columns + 7) / 8
+ *                                      bytes where bit k % 8 of byte k / 8 is set if block k (row-major) is a mine
+ *     uint64_t index[map_count]        the offset of every map record
+ */
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "map_parser.h"
+
+struct CorpusHeader {
+  char magic[8];  // kCorpusMagic
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t map_count;
+  uint64_t index_offset;
+};
+
+struct CorpusMapHeader {
+  int32_t rows;
+  int32_t columns;
+  int32_t first_row;
+  int32_t first_column;
+  int32_t mine_count;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(CorpusHeader) == 32 && sizeof(CorpusMapHeader) == 24, "Corpus records must have no padding");
+
+constexpr char kCorpusMagic[8] = {'M', 'I', 'N', 'E', 'M', 'A', 'P', 'S'};
+constexpr uint32_t kCorpusVersion = 1;
+
+// One map of a corpus, pointing into the mapping
+struct CorpusMap {
+  const CorpusMapHeader *header;
+  const uint8_t *mines;  // The mine bitset
+};
+
+// Writes a corpus file map by map. The index is written by Finish().
+class CorpusWriter {
+ public:
+  CorpusWriter() = default;
+  ~CorpusWriter() { Finish(); }
+  CorpusWriter(const CorpusWriter &) = delete;
+  CorpusWriter &operator=(const CorpusWriter &) = delete;
+
+  // Create or truncate the file at path. Returns false if it cannot be opened.
+  bool Open(const char *path);
+  void Add(int rows, int columns, int first_row, int first_column, const std::vector<std::pair<int, int>> &mines);
+  // Write the index and the final header and close the file
+  bool Finish();
+
+ private:
+  void Pad();
+
+  FILE *file_ = nullptr;
+  uint64_t offset_ = 0;
+  std::vector<uint64_t> index_;
+  std::vector<uint8_t> bits_;
+};
+
+// A corpus file mapped into memory
+class Corpus {
+ public:
+  /**
+   * @brief Map the file at path and check it. Returns false if it is not a valid corpus.
+   * @details Every map record is checked here, so that Map() and Load() can trust it: it must be aligned and lie
+   * inside the file with its whole bitset, its dimensions and first step must be in range, the bits past the last
+   * block must be clear and the mine count must be the number of bits set.
+   */
+  bool Open(const char *path);
+
+  size_t Size() const { return map_count_; }
+  CorpusMap Map(size_t index) const;
+  /**
+   * @brief Set up game with map index and start it
+   * @details The mines come straight from the bitset in the mapping, a word at a time.
+   */
+  void Load(size_t index, Game &game) const;
+
+ private:
+  MappedFile file_;
+  const uint64_t *index_ = nullptr;
+  size_t map_count_ = 0;
+};
+
+inline bool CorpusWriter::Open(const char *path) {
+  Finish();
+  file_ = std::fopen(path, "wb");
+  if (file_ == nullptr) return false;
+  // The real header is written by Finish(), once the counts are known
+  CorpusHeader header{};
+  std::fwrite(&header, sizeof(header), 1, file_);
+  offset_ = sizeof(header);
+  index_.clear();
+  return true;
+}
+
+inline void CorpusWriter::Pad() {
+  static const char kZeros[8] = {};
+  size_t padding = (8 - offset_ % 8) % 8;
+  std::fwrite(kZeros, 1, padding, file_);
+  offset_ += padding;
+}
+
+inline void CorpusWriter::Add(int rows, int columns, int first_row, int first_column,
+                              const std::vector<std::pair<int, int>> &mines) {
+  index_.push_back(offset_);
+  CorpusMapHeader header{rows, columns, first_row, first_column, static_cast<int32_t>(mines.size()), 0};
+  bits_.assign((static_cast<size_t>(rows) * columns + 7) / 8, 0);
+  for (auto [r, c] : mines) {
+    size_t k = static_cast<size_t>(r) * columns + c;
+    bits_[k >> 3] |= static_cast<uint8_t>(1 << (k & 7));
+  }
+  std::fwrite(&header, sizeof(header), 1, file_);
+  std::fwrite(bits_.data(), 1, bits_.size(), file_);
+  offset_ += sizeof(header) + bits_.size();
+  Pad();
+}
+
+inline bool CorpusWriter::Finish() {
+  if (file_ == nullptr) return false;
+  CorpusHeader header{};
+  std::memcpy(header.magic, kCorpusMagic, sizeof(kCorpusMagic));
+  header.version = kCorpusVersion;
+  header.map_count = index_.size();
+  header.index_offset = offset_;
+  std::fwrite(index_.data(), sizeof(uint64_t), index_.size(), file_);
+  std::fseek(file_, 0, SEEK_SET);
+  std::fwrite(&header, sizeof(header), 1, file_);
+  bool ok = std::ferror(file_) == 0;
+  ok = std::fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  return ok;
+}
+
+inline bool Corpus::Open(const char *path) {
+  map_count_ = 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  bool mapped = file_.Open(fd);
+  close(fd);
+  if (!mapped || file_.Size() < sizeof(CorpusHeader)) return false;
+  const auto *header = reinterpret_cast<const CorpusHeader *>(file_.Data());
+  if (std::memcmp(header->magic, kCorpusMagic, sizeof(kCorpusMagic)) != 0 || header->version != kCorpusVersion) {
+    return false;
+  }
+  if (header->index_offset % 8 != 0 || header->index_offset > file_.Size() ||
+      (file_.Size() - header->index_offset) / 8 < header->map_count) {
+    return false;
+  }
+  const auto *index = reinterpret_cast<const uint64_t *>(file_.Data() + header->index_offset);
+  for (uint64_t k = 0; k < header->map_count; k++) {
+    uint64_t offset = index[k];
+    if (offset % 8 != 0 || offset < sizeof(CorpusHeader) || offset > file_.Size() ||
+        file_.Size() - offset < sizeof(CorpusMapHeader)) {
+      return false;
+    }
+    const auto *map = reinterpret_cast<const CorpusMapHeader *>(file_.Data() + offset);
+    if (map->rows <= 0 || map->columns <= 0) return false;
+    // The blocks are numbered with an int, as in Game
+    uint64_t blocks = static_cast<uint64_t>(map->rows) * static_cast<uint64_t>(map->columns);
+    if (blocks > static_cast<uint64_t>(INT32_MAX)) return false;
+    if (file_.Size() - offset - sizeof(CorpusMapHeader) < (blocks + 7) / 8) return false;
+    if (map->first_row < 0 || map->first_row >= map->rows || map->first_column < 0 ||
+        map->first_column >= map->columns) {
+      return false;
+    }
+    const auto *mines = reinterpret_cast<const uint8_t *>(map + 1);
+    size_t bytes = static_cast<size_t>((blocks + 7) / 8);
+    if (blocks % 8 != 0 && (mines[bytes - 1] >> (blocks % 8)) != 0) return false;
+    uint64_t mine_count = 0;
+    for (size_t byte = 0; byte < bytes; byte++) {
+      mine_count += static_cast<uint64_t>(__builtin_popcount(mines[byte]));
+    }
+    if (map->mine_count < 0 || static_cast<uint64_t>(map->mine_count) != mine_count) return false;
+  }
+  index_ = index;
+  map_count_ = header->map_count;
+  return true;
+}
+
+inline CorpusMap Corpus::Map(size_t index) const {
+  const char *record = file_.Data() + index_[index];
+  return {reinterpret_cast<const CorpusMapHeader *>(record),
+          reinterpret_cast<const uint8_t *>(record + sizeof(CorpusMapHeader))};
+}
+
+inline void Corpus::Load(size_t index, Game &game) const {
+  CorpusMap map = Map(index);
+  int columns = map.header->columns;
+  size_t blocks = static_cast<size_t>(map.header->rows) * columns;
+  game.Reset(map.header->rows, columns);
+  for (size_t base = 0; base < blocks; base += 64) {
+    size_t bytes = (blocks - base + 7) / 8 < 8 ? (blocks - base + 7) / 8 : 8;
+    uint64_t word = 0;
+    std::memcpy(&word, map.mines + base / 8, bytes);
+    // Open() has checked that the bits past the last block are clear; keep them out anyway
+    if (blocks - base < 64) word &= (uint64_t{1} << (blocks - base)) - 1;
+    for (; word != 0; word &= word - 1) {
+      size_t k = base + static_cast<size_t>(__builtin_ctzll(word));
+      game.PlaceMine(static_cast<int>(k / columns), static_cast<int>(k % columns));
+    }
+  }
+  game.Start();
+}
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * This header file holds the elimination stage of the client solver, which runs before the probability engine
+ * enumerates anything.
+ *
+ * The frontier is the same system as in probability.h: one row "sum of these blocks = k" per revealed number over 0/1
+ * variables, plus the row of the total number of mines, where the unknown blocks away from the frontier enter as one
+ * integer variable between 0 and their number. Gauss-Jordan elimination combines the rows, and every row then bounds
+ * its variables: a row that can only reach its right-hand side with every variable at one end of its range proves all
+ * of them. The variables found are substituted and both steps repeat until nothing new comes out. This makes the
+ * deductions that need three or more numbers at once, or the mine count, in polynomial time.
+ *
+ * A row keeps its coefficients in {-1, 0, 1} as two bitsets, so that adding or subtracting rows costs a few bitwise
+ * operations per 64 columns. A combination that would make a coefficient 2 or -2 is skipped and the row stays as it
+ * was, which may lose a deduction but never makes a wrong one. The columns follow the order in which the constraints
+ * first name their variables, and the constraints come sorted by position, so most rows span only a few words.
+ */
+#ifndef ELIMINATION_H
+#define ELIMINATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "probability.h"
+
+class EliminationSolver {
+ public:
+  /**
+   * @brief Find the variables, and the blocks away from the frontier, that the constraints prove to be mines or safe
+   *
+   * @param variables The number of frontier blocks, numbered from 0.
+   * @param constraints The constraints over them, as for ProbabilityEngine::Solve().
+   * @param outside The number of unknown blocks that are not on the frontier.
+   * @param remaining_mines The number of mines that are not known yet.
+   * @return false if the constraints contradict each other. Nothing is known then.
+   */
+  bool Solve(int variables, const std::vector<Constraint> &constraints, int outside, int remaining_mines);
+
+  // 1 if variable is a mine, 0 if it is safe, -1 if the constraints do not tell
+  int Value(int variable) const;
+  // 1 if the blocks away from the frontier are all mines, 0 if they are all safe, -1 otherwise
+  int OutsideValue() const;
+
+ private:
+  struct Row {
+    size_t first;  // The words in [first, last) hold every coefficient that is not 0
+    size_t last;
+    int outside;   // Coefficient of the variable of the outside blocks
+    int value;     // Right-hand side
+  };
+
+  uint64_t *Positive(size_t row) { return positive_.data() + row * words_; }
+  uint64_t *Negative(size_t row) { return negative_.data() + row * words_; }
+  uint64_t *Occupancy(size_t column) { return occupancy_.data() + column * row_words_; }
+  void FlipOccupancy(size_t column, size_t row) { Occupancy(column)[row >> 6] ^= uint64_t{1} << (row & 63); }
+  // Coefficient of column in row
+  int Coefficient(size_t row, int column);
+  // Row target -= sign * row source, unless a coefficient would leave {-1, 0, 1}. Returns false if skipped.
+  bool Combine(size_t target, size_t source, int sign);
+  // Gauss-Jordan elimination over the columns not known yet
+  void Eliminate();
+  // Bound every variable through every row. Returns false on a contradiction; sets changed if something was found.
+  bool Propagate(bool &changed);
+  // Take the variables found by the last Propagate() out of every row
+  void Substitute();
+
+  size_t words_ = 0;
+  int columns_ = 0;
+  std::vector<Row> rows_;
+  std::vector<uint64_t> positive_;  // words_ per row: bit c is set if column c has coefficient 1
+  std::vector<uint64_t> negative_;  // Same for -1
+  // The transpose, row_words_ per column: bit r is set if the column is not 0 in row r. Eliminate() finds the rows to
+  // combine with a pivot there instead of testing every row.
+  size_t row_words_ = 0;
+  std::vector<uint64_t> occupancy_;
+  std::vector<uint64_t> pivots_;    // The columns Eliminate() has pivoted on
+  std::vector<int> column_of_;      // Per variable
+  std::vector<uint64_t> known_;     // The columns whose value is known
+  std::vector<uint64_t> mines_;     // The known columns that are mines
+  // Found by the current Propagate(), not substituted yet
+  std::vector<uint64_t> found_mines_;
+  std::vector<uint64_t> found_safe_;
+  int outside_ = 0;
+  int outside_low_ = 0;  // Bounds of the number of mines away from the frontier
+  int outside_high_ = 0;
+};
+
+inline int EliminationSolver::OutsideValue() const {
+  if (outside_ == 0 || outside_low_ != outside_high_) return -1;
+  return outside_low_ == 0 ? 0 : outside_low_ == outside_ ? 1 : -1;
+}
+
+inline int EliminationSolver::Coefficient(size_t row, int column) {
+  size_t word = static_cast<size_t>(column) >> 6;
+  uint64_t bit = uint64_t{1} << (column & 63);
+  return (Positive(row)[word] & bit ? 1 : 0) - (Negative(row)[word] & bit ? 1 : 0);
+}
+
+inline bool EliminationSolver::Combine(size_t target, size_t source, int sign) {
+  Row &to = rows_[target];
+  const Row &from = rows_[source];
+  uint64_t *to_positive = Positive(target);
+  uint64_t *to_negative = Negative(target);
+  // Subtracting -row is adding row: swap the two bitsets of the source
+  const uint64_t *from_positive = sign > 0 ? Positive(source) : Negative(source);
+  const uint64_t *from_negative = sign > 0 ? Negative(source) : Positive(source);
+  for (size_t w = from.first; w < from.last; w++) {
+    // 1 - (-1) and -1 - 1 do not fit
+    if ((to_positive[w] & from_negative[w]) | (to_negative[w] & from_positive[w])) return false;
+  }
+  for (size_t w = from.first; w < from.last; w++) {
+    uint64_t positive = (to_positive[w] & ~from_positive[w]) | (from_negative[w] & ~to_negative[w]);
+    uint64_t negative = (to_negative[w] & ~from_negative[w]) | (from_positive[w] & ~to_positive[w]);
+    for (uint64_t changed = (to_positive[w] | to_negative[w]) ^ (positive | negative); changed != 0;
+         changed &= changed - 1) {
+      FlipOccupancy(w * 64 + static_cast<size_t>(__builtin_ctzll(changed)), target);
+    }
+    to_positive[w] = positive;
+    to_negative[w] = negative;
+  }
+  to.outside -= sign * from.outside;
+  to.value -= sign * from.value;
+  to.first = std::min(to.first, from.first);
+  to.last = std::max(to.last, from.last);
+  while (to.first < to.last && (to_positive[to.first] | to_negative[to.first]) == 0) to.first++;
+  while (to.last > to.first && (to_positive[to.last - 1] | to_negative[to.last - 1]) == 0) to.last--;
+  return true;
+}
+
+inline void EliminationSolver::Eliminate() {
+  // Row by row: the first column of a row that no earlier row pivots on becomes its pivot, and leaves every other row
+  pivots_.assign(words_, 0);
+  for (size_t source = 0; source < rows_.size(); source++) {
+    const Row &from = rows_[source];
+    int column = -1;
+    for (size_t w = from.first; w < from.last && column < 0; w++) {
+      uint64_t candidates = (Positive(source)[w] | Negative(source)[w]) & ~pivots_[w];
+      if (candidates != 0) column = static_cast<int>(w * 64) + __builtin_ctzll(candidates);
+    }
+    if (column < 0) continue;
+    size_t word = static_cast<size_t>(column) >> 6;
+    uint64_t bit = uint64_t{1} << (column & 63);
+    pivots_[word] |= bit;
+    int source_sign = Coefficient(source, column);
+    // Combining only clears the bit of the target in this column, so the words can be read as the loop goes
+    const uint64_t *targets = Occupancy(static_cast<size_t>(column));
+    for (size_t w = 0; w < row_words_; w++) {
+      for (uint64_t rows = targets[w]; rows != 0; rows &= rows - 1) {
+        size_t target = w * 64 + static_cast<size_t>(__builtin_ctzll(rows));
+        if (target == source) continue;
+        Combine(target, source, Coefficient(target, column) * source_sign);
+      }
+    }
+  }
+}
+
+inline int EliminationSolver::Value(int variable) const {
+  size_t column = static_cast<size_t>(column_of_[variable]);
+  uint64_t bit = uint64_t{1} << (column & 63);
+  if (!(known_[column >> 6] & bit)) return -1;
+  return mines_[column >> 6] & bit ? 1 : 0;
+}
+
+inline void EliminationSolver::Substitute() {
+  for (size_t row = 0; row < rows_.size(); row++) {
+    Row &r = rows_[row];
+    uint64_t *positive = Positive(row);
+    uint64_t *negative = Negative(row);
+    for (size_t w = r.first; w < r.last; w++) {
+      r.value -= __builtin_popcountll(positive[w] & found_mines_[w]);
+      r.value += __builtin_popcountll(negative[w] & found_mines_[w]);
+      uint64_t found = found_mines_[w] | found_safe_[w];
+      positive[w] &= ~found;
+      negative[w] &= ~found;
+    }
+  }
+  for (size_t w = 0; w < words_; w++) {
+    known_[w] |= found_mines_[w] | found_safe_[w];
+    mines_[w] |= found_mines_[w];
+    for (uint64_t found = found_mines_[w] | found_safe_[w]; found != 0; found &= found - 1) {
+      uint64_t *rows = Occupancy(w * 64 + static_cast<size_t>(__builtin_ctzll(found)));
+      std::fill(rows, rows + row_words_, 0);
+    }
+  }
+}
+
+inline bool EliminationSolver::Propagate(bool &changed) {
+  found_mines_.assign(words_, 0);
+  found_safe_.assign(words_, 0);
+  bool found = false;
+  for (size_t row = 0; row < rows_.size(); row++) {
+    Row &r = rows_[row];
+    const uint64_t *positive_bits = Positive(row);
+    const uint64_t *negative_bits = Negative(row);
+    // Count the variables found earlier in this pass as known already
+    int positive = 0;
+    int negative = 0;
+    int value = r.value;
+    for (size_t w = r.first; w < r.last; w++) {
+      uint64_t free = ~(found_mines_[w] | found_safe_[w]);
+      positive += __builtin_popcountll(positive_bits[w] & free);
+      negative += __builtin_popcountll(negative_bits[w] & free);
+      value -= __builtin_popcountll(positive_bits[w] & found_mines_[w]);
+      value += __builtin_popcountll(negative_bits[w] & found_mines_[w]);
+    }
+    // The outside variable, bounded by [outside_low_, outside_high_], adds o * y to the row
+    int outside_min = std::min(r.outside * outside_low_, r.outside * outside_high_);
+    int outside_max = std::max(r.outside * outside_low_, r.outside * outside_high_);
+    int low = -negative + outside_min;
+    int high = positive + outside_max;
+    if (value < low || value > high) return false;
+    if (value != low && value != high) {
+      // The 0/1 variables leave o * y within [value - positive, value + negative]
+      if (r.outside == 0) continue;
+      int from = value - positive;
+      int to = value + negative;
+      if (r.outside < 0) std::swap(from, to);
+      // Round towards the inside of the range, whatever the signs
+      auto divide_up = [](int n, int d) { return n / d + ((n % d != 0) && ((n < 0) == (d < 0))); };
+      auto divide_down = [](int n, int d) { return n / d - ((n % d != 0) && ((n < 0) != (d < 0))); };
+      int new_low = std::max(outside_low_, divide_up(from, r.outside));
+      int new_high = std::min(outside_high_, divide_down(to, r.outside));
+      if (new_low > new_high) return false;
+      if (new_low != outside_low_ || new_high != outside_high_) {
+        outside_low_ = new_low;
+        outside_high_ = new_high;
+        changed = true;
+      }
+      continue;
+    }
+    // Every variable of the row sits at the end of its range that gives low, or high
+    bool at_high = value == high;
+    if (positive + negative > 0) {
+      found = true;
+      for (size_t w = r.first; w < r.last; w++) {
+        uint64_t free = ~(found_mines_[w] | found_safe_[w]);
+        found_mines_[w] |= (at_high ? positive_bits[w] : negative_bits[w]) & free;
+        found_safe_[w] |= (at_high ? negative_bits[w] : positive_bits[w]) & free;
+      }
+    }
+    if (r.outside != 0 && outside_low_ != outside_high_) {
+      int bound = (r.outside > 0) == at_high ? outside_high_ : outside_low_;
+      outside_low_ = outside_high_ = bound;
+      changed = true;
+    }
+  }
+  if (found) {
+    Substitute();
+    changed = true;
+  }
+  return true;
+}
+
+inline bool EliminationSolver::Solve(int variables, const std::vector<Constraint> &constraints, int outside,
+                                     int remaining_mines) {
+  // Number the columns in the order the constraints name the variables
+  column_of_.assign(variables, -1);
+  columns_ = 0;
+  for (const Constraint &constraint : constraints) {
+    for (int v : constraint.variables) {
+      if (column_of_[v] < 0) column_of_[v] = columns_++;
+    }
+  }
+  for (int v = 0; v < variables; v++) {
+    if (column_of_[v] < 0) column_of_[v] = columns_++;
+  }
+  words_ = (static_cast<size_t>(columns_) + 63) / 64;
+  known_.assign(words_, 0);
+  mines_.assign(words_, 0);
+  outside_ = outside;
+  outside_low_ = 0;
+  outside_high_ = outside;
+
+  // One row per constraint, and the total mine count over every variable and the outside blocks
+  size_t rows = constraints.size() + 1;
+  rows_.assign(rows, Row{0, 0, 0, 0});
+  positive_.assign(rows * words_, 0);
+  negative_.assign(rows * words_, 0);
+  row_words_ = (rows + 63) / 64;
+  occupancy_.assign(static_cast<size_t>(columns_) * row_words_, 0);
+  for (size_t k = 0; k < constraints.size(); k++) {
+    Row &row = rows_[k];
+    row.first = words_;
+    row.value = constraints[k].mines;
+    for (int v : constraints[k].variables) {
+      size_t column = static_cast<size_t>(column_of_[v]);
+      Positive(k)[column >> 6] |= uint64_t{1} << (column & 63);
+      FlipOccupancy(column, k);
+      row.first = std::min(row.first, column >> 6);
+      row.last = std::max(row.last, (column >> 6) + 1);
+    }
+    if (row.first > row.last) row.first = row.last;
+  }
+  Row &total = rows_[constraints.size()];
+  total = {0, words_, 1, remaining_mines};
+  for (int column = 0; column < columns_; column++) {
+    Positive(constraints.size())[column >> 6] |= uint64_t{1} << (column & 63);
+    FlipOccupancy(static_cast<size_t>(column), constraints.size());
+  }
+
+  // Propagation is cheap next to elimination, so it runs until it finds nothing before the rows are combined again
+  bool eliminate = true;
+  while (eliminate) {
+    Eliminate();
+    eliminate = false;
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      if (!Propagate(changed)) {
+        known_.assign(words_, 0);
+        outside_low_ = 0;
+        outside_high_ = outside;
+        return false;
+      }
+      eliminate = eliminate || changed;
+    }
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,387 @@
+/**
+ * This header file holds the game engine behind server.h. All the state of one game lives in a Game object, so a
+ * process can run any number of games, and a finished Game can be reset and reused without reallocating its storage.
+ * See server.h for the rules each operation implements.
+ */
+#ifndef GAME_H
+#define GAME_H
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "map_parser.h"
+#include "trace.h"
+
+// The state of a Game at one point, to go back to with Game::Rollback()
+struct GameCheckpoint {
+  size_t changes;  // Length of the change journal
+  int state;
+  int visit_count;
+  int marked_mine_count;
+};
+
+class Game {
+ public:
+  /**
+   * @brief Start setting up a new game on a rows * columns map without mines
+   * @details Place the mines with PlaceMine() and call Start() afterwards. The storage of the previous game is reused.
+   */
+  void Reset(int rows, int columns);
+  void PlaceMine(int r, int c);
+  // Finish setting up: cache the mine counts and clear the frame and the change journal
+  void Start();
+  // Place a mine on every 'X' of row r, given as columns map symbols
+  void LoadRow(int r, const char *row);
+  // Reset, read rows lines of columns characters ('X' for a mine, '.' otherwise) from in, and start
+  void Read(int rows, int columns, std::istream &in);
+
+  void VisitBlock(int r, int c);
+  void MarkMine(int r, int c);
+  void AutoExplore(int r, int c);
+  // 0 for VisitBlock(r, c), 1 for MarkMine(r, c) and 2 for AutoExplore(r, c). Other types are ignored.
+  void Apply(int r, int c, int type);
+
+  // Remember the current state, to try some operations and undo them with Rollback()
+  GameCheckpoint Checkpoint() const { return {changes_.size(), state_, visit_count_, marked_mine_count_}; }
+  /**
+   * @brief Undo every operation since checkpoint was taken
+   * @details Every block visited or marked since then is in the change journal after checkpoint.changes, so the
+   * rollback clears exactly those blocks and costs time proportional to what changed. Checkpoints nest: rolling back
+   * to one discards every checkpoint taken after it. The blocks that go back to '?' are reported by the next
+   * CollectDirtyBlocks().
+   */
+  void Rollback(const GameCheckpoint &checkpoint);
+
+  int Rows() const { return rows_; }
+  int Columns() const { return columns_; }
+  int TotalMines() const { return total_mines_; }
+  // 0 for continuing, 1 for winning, -1 for losing
+  int State() const { return state_; }
+  int VisitCount() const { return visit_count_; }
+  int MarkedMineCount() const { return marked_mine_count_; }
+  int CountAdjacentMines(int r, int c) const { return board_[r][c].count; }
+  const Board &GetBoard() const { return board_; }
+  // Every block visited or marked so far, in the order it happened. Each block appears at most once.
+  const std::vector<std::pair<int, int>> &Changes() const { return changes_; }
+
+  // The symbol PrintMap() shows for a block
+  char Symbol(int r, int c) const;
+  /**
+   * @brief Bring the frame up to date and return the blocks whose symbol changed since the last call
+   * @details Only the blocks changed since the last render are rewritten, so the cost is proportional to what changed.
+   * The only exception is winning, which redraws every unmarked mine once.
+   */
+  const std::vector<std::pair<int, int>> &CollectDirtyBlocks();
+  // Write the whole map with a single call
+  void PrintMap(std::ostream &out);
+  // Write the number of changed blocks, then one "r c symbol" line for each of them
+  void PrintDiff(std::ostream &out);
+  // Write "YOU WIN!" or "GAME OVER!", then the visit count and the marked mine count
+  void PrintResult(std::ostream &out) const;
+
+ private:
+  bool InBounds(int r, int c) const { return r >= 0 && r < rows_ && c >= 0 && c < columns_; }
+  // Visit (r, c) and flood through the connected blocks with mine count 0, using flood_stack_ instead of recursion
+  void VisitInternal(int r, int c);
+  size_t FrameIndex(int r, int c) const { return static_cast<size_t>(r) * (columns_ + 1) + c; }
+
+  int rows_ = 0;
+  int columns_ = 0;
+  int total_mines_ = 0;
+  int state_ = 0;
+  int visit_count_ = 0;        // Number of visited non-mine blocks
+  int marked_mine_count_ = 0;  // Number of correctly marked mines
+  Board board_;
+  std::vector<std::pair<int, int>> flood_stack_;  // Pending blocks of the flood fill
+  std::vector<std::pair<int, int>> changes_;      // See Changes()
+  std::vector<std::pair<int, int>> dirty_;        // Blocks rewritten by the last render
+  std::vector<std::pair<int, int>> undone_;       // Rendered blocks that Rollback() has changed since the last render
+  std::string frame_;          // The map as last rendered, rows * (columns + 1) characters including the newlines
+  size_t render_cursor_ = 0;   // Number of entries of changes_ already written into frame_
+  bool frame_won_ = false;     // True once the unmarked mines have been drawn as @ after winning
+};
+
+inline void Game::Reset(int rows, int columns) {
+  rows_ = rows;
+  columns_ = columns;
+  board_.ResizeBordered(rows, columns, Cell{}, kBorderCell);
+}
+
+inline void Game::PlaceMine(int r, int c) {
+  board_[r][c].mine = true;
+}
+
+inline void Game::Start() {
+  ComputeMineCounts(board_);
+  total_mines_ = 0;
+  for (size_t k = 0; k < board_.Size(); k++) {
+    total_mines_ += board_.Data()[k].mine;
+  }
+  state_ = 0;
+  visit_count_ = 0;
+  marked_mine_count_ = 0;
+  changes_.clear();
+  undone_.clear();
+  render_cursor_ = 0;
+  frame_won_ = false;
+  frame_.assign(static_cast<size_t>(rows_) * (columns_ + 1), '?');
+  for (int i = 0; i < rows_; i++) {
+    frame_[FrameIndex(i, columns_)] = '\n';
+  }
+}
+
+inline void Game::LoadRow(int r, const char *row) {
+  const char *end = row + columns_;
+  for (const char *mine = row; (mine = static_cast<const char *>(std::memchr(mine, 'X', end - mine))) != nullptr;
+       mine++) {
+    PlaceMine(r, static_cast<int>(mine - row));
+  }
+}
+
+inline void Game::Read(int rows, int columns, std::istream &in) {
+  Reset(rows, columns);
+  std::string row(columns, '.');
+  for (int i = 0; i < rows; i++) {
+    if (!ReadMapRow(in, &row[0], columns)) break;
+    LoadRow(i, row.data());
+  }
+  Start();
+}
+
+inline void Game::VisitInternal(int r, int c) {
+  // Check bounds
+  if (!InBounds(r, c)) return;
+
+  // If already visited or marked, do nothing
+  if (board_[r][c].visited || board_[r][c].marked) return;
+
+  // A block is flagged as visited when it is pushed, so every block enters the stack at most once
+  [[maybe_unused]] size_t journal = changes_.size();
+  board_[r][c].visited = true;
+  flood_stack_.clear();
+  flood_stack_.emplace_back(r, c);
+  while (!flood_stack_.empty()) {
+    auto [cr, cc] = flood_stack_.back();
+    flood_stack_.pop_back();
+    changes_.emplace_back(cr, cc);
+
+    // A mine can only be the block that was clicked, since no mine borders a block with mine count 0
+    if (board_[cr][cc].mine) continue;
+    visit_count_++;
+
+    // If mine count is 0, visit all adjacent blocks. The border counts as visited, so it needs no bounds checks.
+    Cell *centre = &board_[cr][cc];
+    if (centre->count != 0) continue;
+    const int *neighbours = board_.Neighbours();
+    for (int k = 0; k < 8; k++) {
+      Cell &cell = centre[neighbours[k]];
+      if (cell.visited || cell.marked) continue;
+      cell.visited = true;
+      flood_stack_.emplace_back(cr + kNeighbourRows[k], cc + kNeighbourColumns[k]);
+    }
+  }
+  TRACE_COUNT("flood_fill_blocks", changes_.size() - journal);
+}
+
+inline void Game::VisitBlock(int r, int c) {
+  TRACE_SCOPE("Game::VisitBlock");
+  // Check bounds
+  if (!InBounds(r, c)) return;
+
+  // If already visited or marked, do nothing
+  if (board_[r][c].visited || board_[r][c].marked) return;
+
+  VisitInternal(r, c);
+
+  // Check if we hit a mine
+  if (board_[r][c].mine) {
+    state_ = -1;
+    return;
+  }
+
+  // Check if we won (all non-mine blocks are visited)
+  if (visit_count_ == rows_ * columns_ - total_mines_) {
+    state_ = 1;
+  }
+}
+
+inline void Game::MarkMine(int r, int c) {
+  TRACE_SCOPE("Game::MarkMine");
+  // Check bounds
+  if (!InBounds(r, c)) return;
+
+  // If already visited or marked, do nothing
+  if (board_[r][c].visited || board_[r][c].marked) return;
+
+  board_[r][c].marked = true;
+  changes_.emplace_back(r, c);
+
+  // Check if it's actually a mine
+  if (board_[r][c].mine) {
+    marked_mine_count_++;
+    // Check if we won (all non-mine blocks are visited)
+    if (visit_count_ == rows_ * columns_ - total_mines_) {
+      state_ = 1;
+    }
+  } else {
+    // Marked a non-mine, game over
+    state_ = -1;
+  }
+}
+
+inline void Game::AutoExplore(int r, int c) {
+  TRACE_SCOPE("Game::AutoExplore");
+  // Check bounds
+  if (!InBounds(r, c)) return;
+
+  // Can only auto-explore visited non-mine blocks
+  if (!board_[r][c].visited || board_[r][c].mine) return;
+
+  // Count marked mines around this block. The border is never marked.
+  const Cell *centre = &board_[r][c];
+  const int *neighbours = board_.Neighbours();
+  int marked_count = 0;
+  for (int k = 0; k < 8; k++) {
+    marked_count += centre[neighbours[k]].marked;
+  }
+
+  // If marked count equals the mine count, visit all non-marked neighbors. Visited blocks, the border among them, are
+  // left out, as VisitBlock() would ignore them anyway.
+  if (marked_count == centre->count) {
+    for (int k = 0; k < 8; k++) {
+      const Cell &cell = centre[neighbours[k]];
+      if (!cell.marked && !cell.visited) {
+        VisitBlock(r + kNeighbourRows[k], c + kNeighbourColumns[k]);
+      }
+    }
+  }
+}
+
+inline void Game::Apply(int r, int c, int type) {
+  if (type == 0) {
+    VisitBlock(r, c);
+  } else if (type == 1) {
+    MarkMine(r, c);
+  } else if (type == 2) {
+    AutoExplore(r, c);
+  }
+}
+
+inline void Game::Rollback(const GameCheckpoint &checkpoint) {
+  // Once won, the frame shows every unmarked mine as @, which has to be undone as well
+  if (frame_won_ && checkpoint.state != 1) {
+    frame_won_ = false;
+    for (int i = 0; i < rows_; i++) {
+      for (int j = 0; j < columns_; j++) {
+        if (board_[i][j].mine && !board_[i][j].marked && !board_[i][j].visited) {
+          undone_.emplace_back(i, j);
+        }
+      }
+    }
+  }
+  for (size_t k = checkpoint.changes; k < changes_.size(); k++) {
+    auto [r, c] = changes_[k];
+    board_[r][c].visited = false;
+    board_[r][c].marked = false;
+    if (k < render_cursor_) {
+      undone_.emplace_back(r, c);
+    }
+  }
+  changes_.resize(checkpoint.changes);
+  if (render_cursor_ > checkpoint.changes) {
+    render_cursor_ = checkpoint.changes;
+  }
+  state_ = checkpoint.state;
+  visit_count_ = checkpoint.visit_count;
+  marked_mine_count_ = checkpoint.marked_mine_count;
+}
+
+inline char Game::Symbol(int r, int c) const {
+  const Cell &cell = board_[r][c];
+  if (cell.visited) {
+    // Visited block: a mine, or the mine count
+    return cell.mine ? 'X' : static_cast<char>('0' + cell.count);
+  }
+  if (cell.marked) {
+    // Marked block: a marked non-mine is shown as X (causes failure)
+    return cell.mine ? '@' : 'X';
+  }
+  // Unvisited and unmarked. Special case: when winning, show all unmarked mines as @
+  return state_ == 1 && cell.mine ? '@' : '?';
+}
+
+inline const std::vector<std::pair<int, int>> &Game::CollectDirtyBlocks() {
+  TRACE_SCOPE("Game::CollectDirtyBlocks");
+  // A block rolled back after a render and changed again is both in undone_ and in the new changes, and a mine
+  // redrawn for a win may have been undone as well. Cell::dirty keeps each block on the list once.
+  dirty_.clear();
+  auto add = [this](int r, int c) {
+    Cell &cell = board_[r][c];
+    if (cell.dirty) return;
+    cell.dirty = true;
+    dirty_.emplace_back(r, c);
+  };
+  for (auto [r, c] : undone_) {
+    add(r, c);
+  }
+  undone_.clear();
+  for (size_t k = render_cursor_; k < changes_.size(); k++) {
+    add(changes_[k].first, changes_[k].second);
+  }
+  render_cursor_ = changes_.size();
+  if (state_ == 1 && !frame_won_) {
+    frame_won_ = true;
+    for (int i = 0; i < rows_; i++) {
+      for (int j = 0; j < columns_; j++) {
+        if (board_[i][j].mine && !board_[i][j].marked && !board_[i][j].visited) {
+          add(i, j);
+        }
+      }
+    }
+  }
+  for (auto [r, c] : dirty_) {
+    board_[r][c].dirty = false;
+    frame_[FrameIndex(r, c)] = Symbol(r, c);
+  }
+  return dirty_;
+}
+
+inline void Game::PrintMap(std::ostream &out) {
+  TRACE_SCOPE("Game::PrintMap");
+  CollectDirtyBlocks();
+  out.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+  out.flush();
+}
+
+inline void Game::PrintDiff(std::ostream &out) {
+  CollectDirtyBlocks();
+  std::string text = std::to_string(dirty_.size()) + '\n';
+  for (auto [r, c] : dirty_) {
+    text += std::to_string(r);
+    text += ' ';
+    text += std::to_string(c);
+    text += ' ';
+    text += frame_[FrameIndex(r, c)];
+    text += '\n';
+  }
+  out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  out.flush();
+}
+
+inline void Game::PrintResult(std::ostream &out) const {
+  if (state_ == 1) {
+    out << "YOU WIN!" << std::endl;
+    // When winning, all mines are considered correctly marked
+    out << visit_count_ << " " << total_mines_ << std::endl;
+  } else {
+    out << "GAME OVER!" << std::endl;
+    out << visit_count_ << " " << marked_mine_count_ << std::endl;
+  }
+}
+
+#endif
@@ -7,7 +7,15 @@
 #ifndef GENERATOR_H
 #define GENERATOR_H
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
 #include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 inline std::mt19937_64 gen;
 
@@ -35,37 +43,153 @@ inline void InitSeed(uint64_t random_seed) {
 }
 
 /**
- * Generate a map.
+ * Find the columns of row i that are too close to the first step (row0, col0) to hold a mine.
+ * They always form one interval [first, last]; first > last if there are none.
  */
-inline void GenerateMap(int rows, int columns, int mine_count, int min_dist) {
-  std::vector<std::pair<int, int>> available_block;
-  bool map[35][35];
-  int row0 = Random(1, rows - 2, gen);
-  int col0 = Random(1, columns - 2, gen);
+inline void ExcludedColumns(int i, int row0, int col0, int min_dist, int columns, int &first, int &last) {
+  int half = min_dist - std::abs(i - row0);
+  first = half < 0 ? 0 : std::max(col0 - half, 0);
+  last = half < 0 ? -1 : std::min(col0 + half, columns - 1);
+}
+
+/**
+ * Choose the mines exactly as the judger does: every mine is a uniformly random entry of the list of blocks still
+ * available in row-major order. Instead of erasing from that list, which costs O(blocks) per mine, the available
+ * blocks are kept in a Fenwick tree, so finding and removing the k-th one costs O(log blocks).
+ */
+inline void GenerateMinesCompatible(int rows, int columns, int mine_count, int min_dist, std::mt19937_64 &gen,
+                                    std::vector<std::pair<int, int>> &mines, int row0, int col0) {
+  size_t n = static_cast<size_t>(rows) * columns;
+  // tree[k] counts the available blocks among the (k & -k) blocks ending at block k - 1
+  std::vector<int> tree(n + 1, 0);
+  int available = 0;
   for (int i = 0; i < rows; ++i) {
+    int first, last;
+    ExcludedColumns(i, row0, col0, min_dist, columns, first, last);
     for (int j = 0; j < columns; ++j) {
-      map[i][j] = false;
-      if (Dist(row0, col0, i, j) <= min_dist) {
-        continue;
+      size_t k = static_cast<size_t>(i) * columns + j + 1;
+      if (j < first || j > last) {
+        tree[k]++;
+        available++;
+      }
+      size_t parent = k + (k & (~k + 1));
+      if (parent <= n) {
+        tree[parent] += tree[k];
       }
-      available_block.emplace_back(i, j);
     }
   }
-  for (int i = 0; i < mine_count; ++i) {
-    auto cnt = available_block.size();
-    auto mine_pos = Random(0, static_cast<int>(cnt) - 1, gen);
-    auto &mine = available_block[mine_pos];
-    map[mine.first][mine.second] = true;
-    available_block.erase(available_block.begin() + mine_pos);
+  size_t top = 1;
+  while (top * 2 <= n) {
+    top *= 2;
   }
-  std::cout << rows << "  " << columns << std::endl;
+  for (int m = 0; m < mine_count; ++m) {
+    int rank = Random(0, available - 1, gen) + 1;
+    size_t pos = 0;
+    for (size_t step = top; step > 0; step /= 2) {
+      if (pos + step <= n && tree[pos + step] < rank) {
+        pos += step;
+        rank -= tree[pos];
+      }
+    }
+    // pos is now the 0-based index of the chosen block
+    for (size_t k = pos + 1; k <= n; k += k & (~k + 1)) {
+      tree[k]--;
+    }
+    available--;
+    mines.emplace_back(static_cast<int>(pos / columns), static_cast<int>(pos % columns));
+  }
+}
+
+/**
+ * Choose a uniformly random set of mine_count available blocks in O(rows + mine_count) with Floyd's sampling
+ * algorithm, which draws exactly one random number per mine. The available blocks are numbered in row-major order
+ * without ever being listed: a per-row prefix count turns a number back into a block. The result does not match the
+ * judger's sequence.
+ */
+inline void GenerateMinesFast(int rows, int columns, int mine_count, int min_dist, std::mt19937_64 &gen,
+                              std::vector<std::pair<int, int>> &mines, int row0, int col0) {
+  // prefix[i] is the number of available blocks in rows [0, i)
+  std::vector<int64_t> prefix(rows + 1, 0);
   for (int i = 0; i < rows; ++i) {
-    for (int j = 0; j < columns; ++j) {
-      std::cout << (map[i][j] ? 'X' : '.');
+    int first, last;
+    ExcludedColumns(i, row0, col0, min_dist, columns, first, last);
+    prefix[i + 1] = prefix[i] + columns - std::max(last - first + 1, 0);
+  }
+  auto block_of = [&](int64_t number) {
+    int i = static_cast<int>(std::upper_bound(prefix.begin(), prefix.end(), number) - prefix.begin()) - 1;
+    int first, last;
+    ExcludedColumns(i, row0, col0, min_dist, columns, first, last);
+    int j = static_cast<int>(number - prefix[i]);
+    if (j >= first) {
+      j += std::max(last - first + 1, 0);
     }
-    std::cout << std::endl;
+    return std::make_pair(i, j);
+  };
+
+  // Remember the chosen numbers in a bitmap if it is at most 8 words per mine, and in a hash set otherwise
+  int available = static_cast<int>(prefix[rows]);
+  bool use_bitmap = available / 64 <= static_cast<int64_t>(mine_count) * 8;
+  std::vector<uint64_t> bitmap(use_bitmap ? available / 64 + 1 : 0, 0);
+  std::unordered_set<int> chosen;
+  if (!use_bitmap) {
+    chosen.reserve(static_cast<size_t>(mine_count) * 2);
+  }
+  auto insert = [&](int number) {
+    if (!use_bitmap) return chosen.insert(number).second;
+    uint64_t bit = uint64_t{1} << (number % 64);
+    bool fresh = (bitmap[number / 64] & bit) == 0;
+    bitmap[number / 64] |= bit;
+    return fresh;
+  };
+  for (int top = available - mine_count; top < available; ++top) {
+    int number = Random(0, top, gen);
+    if (!insert(number)) {
+      // Nothing chosen so far is larger than top - 1, so top itself is always free
+      number = top;
+      insert(number);
+    }
+    mines.push_back(block_of(number));
+  }
+}
+
+/**
+ * Choose the mines of a map and the first step, without printing anything.
+ * The positions of the mines are stored in mines.
+ *
+ * @param compatible If true, the map is exactly the one GenerateMap() has always produced for the same state of gen.
+ * Otherwise a faster sampler is used that only depends on the number of mines, not on the number of blocks.
+ */
+inline void GenerateMines(int rows, int columns, int mine_count, int min_dist, std::mt19937_64 &gen,
+                          std::vector<std::pair<int, int>> &mines, int &row0, int &col0, bool compatible = true) {
+  row0 = Random(1, rows - 2, gen);
+  col0 = Random(1, columns - 2, gen);
+  mines.clear();
+  if (compatible) {
+    GenerateMinesCompatible(rows, columns, mine_count, min_dist, gen, mines, row0, col0);
+  } else {
+    GenerateMinesFast(rows, columns, mine_count, min_dist, gen, mines, row0, col0);
+  }
+}
+
+/**
+ * Generate a map.
+ */
+inline void GenerateMap(int rows, int columns, int mine_count, int min_dist) {
+  std::vector<std::pair<int, int>> mines;
+  int row0, col0;
+  GenerateMines(rows, columns, mine_count, min_dist, gen, mines, row0, col0);
+  std::string text = std::to_string(rows) + "  " + std::to_string(columns) + "\n";
+  size_t start = text.size();
+  text.append(static_cast<size_t>(rows) * (columns + 1), '.');
+  for (int i = 0; i < rows; ++i) {
+    text[start + static_cast<size_t>(i) * (columns + 1) + columns] = '\n';
+  }
+  for (auto [r, c] : mines) {
+    text[start + static_cast<size_t>(r) * (columns + 1) + c] = 'X';
   }
-  std::cout << row0 << " " << col0 << std::endl;
+  text += std::to_string(row0) + " " + std::to_string(col0) + "\n";
+  std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+  std::cout.flush();
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+/**
+ * This header file provides the batch evaluation harness: it plays many generated games with the client's solver
+ * against the server's game engine, in memory and spread over all cores.
+ */
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "corpus.h"
+#include "game.h"
+#include "generator.h"
+#include "solver.h"
+#include "spsc_ring.h"
+#include "thread_pool.h"
+
+struct BatchConfig {
+  int rows = 30;
+  int columns = 30;
+  int mine_count = 150;
+  uint64_t seed = 0;
+  int min_dist = 1;
+  int64_t games = 50;
+  int threads = 0;               // 0 means one per hardware thread
+  bool compatible_maps = false;  // Generate maps with the judger's sampler instead of the faster one
+  const Corpus *corpus = nullptr;  // Replay the maps of a corpus, game k on map k % Size(), instead of generating them
+  RolloutConfig rollout;           // Guess with the rollout guesser (see rollout.h) if enabled
+  bool pipelined = false;          // Play every game with a PipelinedPlayer, two threads per worker
+};
+
+struct GameResult {
+  bool won = false;
+  int visit_count = 0;        // Visited non-mine blocks
+  int marked_mine_count = 0;  // Correctly marked mines; all mines if the game was won
+};
+
+struct BatchReport {
+  int64_t games = 0;
+  int64_t wins = 0;
+  int64_t visit_count = 0;
+  double score = 0.0;  // Sum over all games of (marked mines + visited blocks) / blocks, as the OJ scores them
+  double seconds = 0.0;
+};
+
+/**
+ * @brief Play one game to the end. game must be started already; first_row and first_column are the first step.
+ */
+inline GameResult PlayGame(Game &game, Solver &solver, int first_row, int first_column) {
+  solver.Reset(game.Rows(), game.Columns(), game.TotalMines());
+  Action action{first_row, first_column, 0};
+  while (true) {
+    game.Apply(action.r, action.c, action.type);
+    if (game.State() != 0) break;
+    // Proven actions need no new information, so the solver only catches up once its queue is empty
+    if (solver.HasPendingActions() && solver.Decide(action)) continue;
+    const std::vector<std::pair<int, int>> &dirty = game.CollectDirtyBlocks();
+    // An action that changes nothing would be chosen again forever
+    if (dirty.empty()) break;
+    for (auto [r, c] : dirty) {
+      solver.UpdateBlock(r, c, game.Symbol(r, c));
+    }
+    if (!solver.Decide(action)) break;
+  }
+  GameResult result;
+  result.won = game.State() == 1;
+  result.visit_count = game.VisitCount();
+  result.marked_mine_count = result.won ? game.TotalMines() : game.MarkedMineCount();
+  return result;
+}
+
+/**
+ * @brief Plays games like PlayGame(), with the server side on a thread of its own
+ *
+ * @details The client thread (the caller of Play()) and the server thread talk through two SpscRing queues: actions
+ * one way, and the blocks that changed, followed by the game state, the other way. Proven actions need nothing back,
+ * so the client sends them as fast as the solver hands them out while the server applies the ones before; it only
+ * waits for the map when it runs out. The server then streams the changed blocks, and the client feeds them to the
+ * solver while the server still collects the rest. The games are the same as with PlayGame(), action for action.
+ *
+ * The server thread lives as long as the player, so one player serves any number of games. With two threads per game,
+ * a batch should run about half as many workers as there are cores.
+ */
+class PipelinedPlayer {
+ public:
+  PipelinedPlayer() : server_(&PipelinedPlayer::ServerLoop, this) {}
+  ~PipelinedPlayer();
+  PipelinedPlayer(const PipelinedPlayer &) = delete;
+  PipelinedPlayer &operator=(const PipelinedPlayer &) = delete;
+
+  // Play one game to the end, as PlayGame() does. The server thread owns game until Play() returns.
+  GameResult Play(Game &game, Solver &solver, int first_row, int first_column);
+
+ private:
+  // Action types beyond the three of Execute(): send the changes since the last sync, and stop the server thread
+  static constexpr int kSync = 3;
+  static constexpr int kStop = 4;
+
+  // A changed block, or with r == -1 the end of a sync, with the game state in c
+  struct Event {
+    int r;
+    int c;
+    char symbol;
+  };
+
+  void ServerLoop();
+
+  Game *game_ = nullptr;  // Published to the server thread by the first action of each game
+  SpscRing<Action, 1024> actions_;
+  SpscRing<Event, 4096> events_;
+  std::thread server_;
+};
+
+inline PipelinedPlayer::~PipelinedPlayer() {
+  actions_.Push({0, 0, kStop});
+  server_.join();
+}
+
+inline void PipelinedPlayer::ServerLoop() {
+  while (true) {
+    Action action = actions_.Pop();
+    if (action.type == kStop) return;
+    Game &game = *game_;
+    if (action.type == kSync) {
+      // A finished game has nothing more to tell the client
+      if (game.State() == 0) {
+        for (auto [r, c] : game.CollectDirtyBlocks()) {
+          events_.Push({r, c, game.Symbol(r, c)});
+        }
+      }
+      events_.Push({-1, game.State(), 0});
+    } else if (game.State() == 0) {
+      // The actions queued after the one that ended the game are dropped, as PlayGame() never takes them
+      game.Apply(action.r, action.c, action.type);
+    }
+  }
+}
+
+inline GameResult PipelinedPlayer::Play(Game &game, Solver &solver, int first_row, int first_column) {
+  solver.Reset(game.Rows(), game.Columns(), game.TotalMines());
+  game_ = &game;
+  Action action{first_row, first_column, 0};
+  actions_.Push(action);
+  while (true) {
+    actions_.Push({0, 0, kSync});
+    int changed = 0;
+    Event event = events_.Pop();
+    for (; event.r != -1; event = events_.Pop()) {
+      solver.UpdateBlock(event.r, event.c, event.symbol);
+      changed++;
+    }
+    // An action that changes nothing would be chosen again forever
+    if (event.c != 0 || changed == 0) break;
+    if (!solver.Decide(action)) break;
+    actions_.Push(action);
+    while (solver.HasPendingActions() && solver.Decide(action)) {
+      actions_.Push(action);
+    }
+  }
+  // The server is idle after the end of a sync, so the game can be read here
+  GameResult result;
+  result.won = game.State() == 1;
+  result.visit_count = game.VisitCount();
+  result.marked_mine_count = result.won ? game.TotalMines() : game.MarkedMineCount();
+  return result;
+}
+
+/**
+ * @brief Seed of game index of a batch
+ * @details Every game gets its own generator, so the maps do not depend on how games are spread over the threads.
+ * The index is mixed with SplitMix64 so that neighbouring games get unrelated seeds.
+ */
+inline uint64_t GameSeed(uint64_t seed, uint64_t index) {
+  uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * @brief Write the maps config.games games of a batch would be played on to a corpus file at path
+ * @details Replaying the corpus with BatchConfig::corpus plays exactly the games RunBatch() would generate.
+ */
+inline bool SaveCorpus(const BatchConfig &config, const char *path) {
+  CorpusWriter writer;
+  if (!writer.Open(path)) return false;
+  std::vector<std::pair<int, int>> mines;
+  for (int64_t index = 0; index < config.games; index++) {
+    std::mt19937_64 rng(GameSeed(config.seed, static_cast<uint64_t>(index)));
+    int row0, col0;
+    GenerateMines(config.rows, config.columns, config.mine_count, config.min_dist, rng, mines, row0, col0,
+                  config.compatible_maps);
+    writer.Add(config.rows, config.columns, row0, col0, mines);
+  }
+  return writer.Finish();
+}
+
+/**
+ * @brief Generate and play config.games games on a thread pool and sum up the results
+ * @details Every worker keeps its own Game and Solver and reuses them for all the games it plays.
+ */
+inline BatchReport RunBatch(const BatchConfig &config, ThreadPool &pool) {
+  struct alignas(64) WorkerState {
+    Game game;
+    Solver solver;
+    std::unique_ptr<PipelinedPlayer> player;  // Only with BatchConfig::pipelined
+    std::vector<std::pair<int, int>> mines;
+    BatchReport report;
+  };
+  std::vector<WorkerState> workers(pool.Size());
+  for (WorkerState &state : workers) {
+    state.solver.SetRollout(config.rollout);
+    if (config.pipelined) state.player.reset(new PipelinedPlayer);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  pool.Run(static_cast<size_t>(config.games), [&](size_t index, int worker) {
+    WorkerState &state = workers[worker];
+    int row0, col0;
+    if (config.corpus != nullptr) {
+      size_t map = index % config.corpus->Size();
+      config.corpus->Load(map, state.game);
+      row0 = config.corpus->Map(map).header->first_row;
+      col0 = config.corpus->Map(map).header->first_column;
+    } else {
+      std::mt19937_64 rng(GameSeed(config.seed, index));
+      GenerateMines(config.rows, config.columns, config.mine_count, config.min_dist, rng, state.mines, row0, col0,
+                    config.compatible_maps);
+      state.game.Reset(config.rows, config.columns);
+      for (auto [r, c] : state.mines) {
+        state.game.PlaceMine(r, c);
+      }
+      state.game.Start();
+    }
+
+    GameResult result = state.player ? state.player->Play(state.game, state.solver, row0, col0)
+                                     : PlayGame(state.game, state.solver, row0, col0);
+    state.report.games++;
+    state.report.wins += result.won;
+    state.report.visit_count += result.visit_count;
+    state.report.score += static_cast<double>(result.visit_count + result.marked_mine_count) /
+                          (static_cast<double>(state.game.Rows()) * state.game.Columns());
+  });
+
+  BatchReport total;
+  for (const WorkerState &state : workers) {
+    total.games += state.report.games;
+    total.wins += state.report.wins;
+    total.visit_count += state.report.visit_count;
+    total.score += state.report.score;
+  }
+  total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return total;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * This header file holds the fast text parser for maps, shared by InitMap() and ReadMap(). A map is read a whole row at
+ * a time instead of one formatted `>> c` per block, either from a stream buffer or straight from a memory-mapped file.
+ * Whitespace is allowed anywhere between blocks, so the double-space header of GenerateMap() and CRLF line ends parse
+ * the same as the usual format.
+ */
+#ifndef MAP_PARSER_H
+#define MAP_PARSER_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+
+// Map symbols are printable, so anything up to ' ' is whitespace or a control character
+inline bool IsMapSpace(char c) { return static_cast<unsigned char>(c) <= ' '; }
+
+/**
+ * @brief True if [begin, begin + size) holds no whitespace
+ * @details A min-reduction over the bytes, which the compiler vectorizes, instead of classifying every byte.
+ */
+inline bool IsDenseRow(const char *begin, size_t size) {
+  unsigned char low = 0xff;
+  for (size_t k = 0; k < size; k++) {
+    unsigned char c = static_cast<unsigned char>(begin[k]);
+    low = c < low ? c : low;
+  }
+  return low > ' ';
+}
+
+/**
+ * @brief Skip whitespace in in and read the next columns symbols of a map into row
+ * @details The row is read with one bulk read of the stream buffer. Only if it turns out to contain whitespace are
+ * the symbols compacted and the rest read again. Returns false if the input ends first.
+ */
+inline bool ReadMapRow(std::istream &in, char *row, int columns) {
+  std::streambuf *buffer = in.rdbuf();
+  int filled = 0;
+  while (filled < columns) {
+    // Skip whitespace
+    int c = buffer->sgetc();
+    while (c != std::char_traits<char>::eof() && IsMapSpace(static_cast<char>(c))) {
+      c = buffer->snextc();
+    }
+    if (c == std::char_traits<char>::eof()) {
+      in.setstate(std::ios::eofbit | std::ios::failbit);
+      return false;
+    }
+    std::streamsize got = buffer->sgetn(row + filled, columns - filled);
+    if (IsDenseRow(row + filled, static_cast<size_t>(got))) {
+      filled += static_cast<int>(got);
+      continue;
+    }
+    // Drop the whitespace and read what is missing on the next round
+    int end = filled + static_cast<int>(got);
+    for (int k = filled; k < end; k++) {
+      if (!IsMapSpace(row[k])) row[filled++] = row[k];
+    }
+  }
+  return true;
+}
+
+// Skip whitespace in [cursor, end) and parse a non-negative decimal integer. Returns false if there is none.
+inline bool ParseInt(const char *&cursor, const char *end, int &value) {
+  while (cursor < end && IsMapSpace(*cursor)) cursor++;
+  if (cursor == end || *cursor < '0' || *cursor > '9') return false;
+  value = 0;
+  while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+    value = value * 10 + (*cursor++ - '0');
+  }
+  return true;
+}
+
+/**
+ * @brief Skip whitespace in [cursor, end) and return the next columns symbols of a map, or nullptr if the block ends
+ * first
+ * @details A row without embedded whitespace is returned in place, without copying; any other row is compacted into
+ * scratch.
+ */
+inline const char *ParseMapRow(const char *&cursor, const char *end, int columns, std::string &scratch) {
+  while (cursor < end && IsMapSpace(*cursor)) cursor++;
+  if (end - cursor >= columns && IsDenseRow(cursor, static_cast<size_t>(columns))) {
+    const char *row = cursor;
+    cursor += columns;
+    return row;
+  }
+  scratch.clear();
+  while (static_cast<int>(scratch.size()) < columns) {
+    while (cursor < end && IsMapSpace(*cursor)) cursor++;
+    if (cursor == end) return nullptr;
+    scratch += *cursor++;
+  }
+  return scratch.data();
+}
+
+// A read-only memory mapping of a whole regular file
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Map the file behind fd. Returns false if it is not a regular file or cannot be mapped.
+  bool Open(int fd);
+  void Close();
+
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+inline bool MappedFile::Open(int fd) {
+  Close();
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) return false;
+  void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) return false;
+  madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(data);
+  size_ = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+inline void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+#endif
@@ -0,0 +1,309 @@
+/**
+ * This header file holds a small microbenchmark runner in the style of Google Benchmark, for the bench target. A
+ * benchmark is a function that runs its workload in a `while (state.KeepRunning())` loop; it is registered once per set
+ * of arguments, and the runner grows the number of iterations until one run takes at least the minimum time.
+ *
+ *     bench [--filter=regex] [--format=console|json|csv] [--min_time=seconds] [--list]
+ *
+ * Every run is named as in Google Benchmark, the benchmark and then each argument as /name:value (see --list), and
+ * --filter selects the runs whose name the regex matches anywhere. A filter that selects no run is an error. The json
+ * and csv formats follow the ones of Google Benchmark, so the results can be compared across commits with the usual
+ * tools.
+ */
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Keep the compiler from optimizing value, or the computation behind it, away
+template <typename T>
+inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchmarkState {
+ public:
+  BenchmarkState(const std::vector<int64_t> &args, int64_t iterations) : args_(args), iterations_(iterations) {}
+
+  /**
+   * @brief The loop condition of a benchmark
+   * @details The timers start on the first call and stop on the call that ends the loop, so the setup before the loop
+   * is not measured.
+   */
+  bool KeepRunning() {
+    if (remaining_ == -1) {
+      remaining_ = iterations_;
+      ResumeTiming();
+    }
+    if (remaining_ > 0) {
+      remaining_--;
+      return true;
+    }
+    PauseTiming();
+    return false;
+  }
+  // Leave out the work between PauseTiming() and ResumeTiming() from the measurement
+  void PauseTiming();
+  void ResumeTiming();
+
+  int64_t Range(size_t k) const { return args_[k]; }
+  int64_t Iterations() const { return iterations_; }
+  // The amount of work done by all the iterations, reported per second
+  void SetItemsProcessed(int64_t items) { items_ = items; }
+  void SetBytesProcessed(int64_t bytes) { bytes_ = bytes; }
+  void SetLabel(const std::string &label) { label_ = label; }
+
+  double RealSeconds() const { return real_seconds_; }
+  double CpuSeconds() const { return cpu_seconds_; }
+  int64_t Items() const { return items_; }
+  int64_t Bytes() const { return bytes_; }
+  const std::string &Label() const { return label_; }
+
+ private:
+  static double CpuNow() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+  }
+
+  std::vector<int64_t> args_;
+  int64_t iterations_;
+  int64_t remaining_ = -1;
+  bool running_ = false;
+  std::chrono::steady_clock::time_point real_start_;
+  double cpu_start_ = 0.0;
+  double real_seconds_ = 0.0;
+  double cpu_seconds_ = 0.0;
+  int64_t items_ = 0;
+  int64_t bytes_ = 0;
+  std::string label_;
+};
+
+// A benchmark function and the argument sets it runs with. Built with chained calls, as in Google Benchmark.
+class Benchmark {
+ public:
+  Benchmark(std::string name, std::function<void(BenchmarkState &)> function)
+      : name_(std::move(name)), function_(std::move(function)) {}
+
+  // Names of the arguments, shown in the name of every run as name:value
+  Benchmark &ArgNames(const std::vector<std::string> &names) {
+    arg_names_ = names;
+    return *this;
+  }
+  // Run the benchmark once more with these arguments
+  Benchmark &Args(const std::vector<int64_t> &args) {
+    arg_sets_.push_back(args);
+    return *this;
+  }
+
+ private:
+  friend class BenchmarkRunner;
+
+  std::string RunName(const std::vector<int64_t> &args) const;
+
+  std::string name_;
+  std::function<void(BenchmarkState &)> function_;
+  std::vector<std::string> arg_names_;
+  std::vector<std::vector<int64_t>> arg_sets_;
+};
+
+class BenchmarkRunner {
+ public:
+  Benchmark &Register(const std::string &name, std::function<void(BenchmarkState &)> function) {
+    benchmarks_.emplace_back(name, std::move(function));
+    return benchmarks_.back();
+  }
+  // Parse the command line and run every benchmark that matches the filter. Returns the exit status of the program.
+  int Run(int argc, char *argv[]);
+
+ private:
+  struct Result {
+    std::string name;
+    int64_t iterations;
+    double real_ns;  // Per iteration
+    double cpu_ns;
+    double items_per_second;
+    double bytes_per_second;
+    std::string label;
+  };
+
+  // Run one benchmark with more and more iterations until it takes min_time seconds
+  Result Measure(const Benchmark &benchmark, const std::vector<int64_t> &args, double min_time) const;
+  static void PrintJson(const char *executable, const std::vector<Result> &results);
+
+  std::deque<Benchmark> benchmarks_;  // A deque, so that Register() can return a reference that stays valid
+};
+
+inline void BenchmarkState::PauseTiming() {
+  if (!running_) return;
+  real_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start_).count();
+  cpu_seconds_ += CpuNow() - cpu_start_;
+  running_ = false;
+}
+
+inline void BenchmarkState::ResumeTiming() {
+  if (running_) return;
+  running_ = true;
+  cpu_start_ = CpuNow();
+  real_start_ = std::chrono::steady_clock::now();
+}
+
+inline std::string Benchmark::RunName(const std::vector<int64_t> &args) const {
+  std::string name = name_;
+  for (size_t k = 0; k < args.size(); k++) {
+    name += '/';
+    if (k < arg_names_.size()) name += arg_names_[k] + ":";
+    name += std::to_string(args[k]);
+  }
+  return name;
+}
+
+inline BenchmarkRunner::Result BenchmarkRunner::Measure(const Benchmark &benchmark, const std::vector<int64_t> &args,
+                                                        double min_time) const {
+  int64_t iterations = 1;
+  while (true) {
+    BenchmarkState state(args, iterations);
+    benchmark.function_(state);
+    double seconds = state.RealSeconds();
+    // Stop once the run is long enough, or cannot grow any more
+    if (seconds >= min_time || iterations >= int64_t{1} << 40) {
+      Result result;
+      result.name = benchmark.RunName(args);
+      result.iterations = iterations;
+      result.real_ns = seconds * 1e9 / static_cast<double>(iterations);
+      result.cpu_ns = state.CpuSeconds() * 1e9 / static_cast<double>(iterations);
+      result.items_per_second = seconds > 0.0 ? static_cast<double>(state.Items()) / seconds : 0.0;
+      result.bytes_per_second = seconds > 0.0 ? static_cast<double>(state.Bytes()) / seconds : 0.0;
+      result.label = state.Label();
+      return result;
+    }
+    // Aim 40% past the minimum time, but grow at most tenfold at a time
+    double factor = seconds > 0.0 ? min_time * 1.4 / seconds : 10.0;
+    factor = factor > 10.0 ? 10.0 : factor;
+    int64_t next = static_cast<int64_t>(static_cast<double>(iterations) * factor);
+    iterations = next > iterations ? next : iterations + 1;
+  }
+}
+
+inline void BenchmarkRunner::PrintJson(const char *executable, const std::vector<Result> &results) {
+  char date[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+  char host[256] = "";
+  gethostname(host, sizeof(host) - 1);
+#ifdef NDEBUG
+  const char *build_type = "release";
+#else
+  const char *build_type = "debug";
+#endif
+  std::printf("{\n  \"context\": {\n    \"date\": \"%s\",\n    \"host_name\": \"%s\",\n    \"executable\": \"%s\",\n"
+              "    \"num_cpus\": %u,\n    \"library_build_type\": \"%s\"\n  },\n  \"benchmarks\": [",
+              date, host, executable, std::thread::hardware_concurrency(), build_type);
+  for (size_t k = 0; k < results.size(); k++) {
+    const Result &result = results[k];
+    std::printf("%s\n    {\"name\": \"%s\", \"run_name\": \"%s\", \"run_type\": \"iteration\", \"iterations\": %lld, "
+                "\"real_time\": %.3f, \"cpu_time\": %.3f, \"time_unit\": \"ns\"",
+                k == 0 ? "" : ",", result.name.c_str(), result.name.c_str(),
+                static_cast<long long>(result.iterations), result.real_ns, result.cpu_ns);
+    if (result.bytes_per_second > 0.0) std::printf(", \"bytes_per_second\": %.6g", result.bytes_per_second);
+    if (result.items_per_second > 0.0) std::printf(", \"items_per_second\": %.6g", result.items_per_second);
+    if (!result.label.empty()) std::printf(", \"label\": \"%s\"", result.label.c_str());
+    std::printf("}");
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+inline int BenchmarkRunner::Run(int argc, char *argv[]) {
+  std::string filter = ".";
+  std::string format = "console";
+  double min_time = 0.5;
+  bool list = false;
+  for (int k = 1; k < argc; k++) {
+    if (std::strncmp(argv[k], "--filter=", 9) == 0) {
+      filter = argv[k] + 9;
+    } else if (std::strncmp(argv[k], "--format=", 9) == 0) {
+      format = argv[k] + 9;
+    } else if (std::strncmp(argv[k], "--min_time=", 11) == 0) {
+      min_time = std::atof(argv[k] + 11);
+    } else if (std::strcmp(argv[k], "--list") == 0) {
+      list = true;
+    } else {
+      std::fprintf(stderr, "Usage: %s [--filter=regex] [--format=console|json|csv] [--min_time=seconds] [--list]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+  if (format != "console" && format != "json" && format != "csv") {
+    std::fprintf(stderr, "Unknown format %s\n", format.c_str());
+    return 1;
+  }
+  std::regex pattern;
+  try {
+    pattern = std::regex(filter);
+  } catch (const std::regex_error &) {
+    std::fprintf(stderr, "Invalid filter %s\n", filter.c_str());
+    return 1;
+  }
+
+  // Select the runs first, so that a filter that matches nothing prints no header
+  std::vector<std::pair<const Benchmark *, std::vector<int64_t>>> runs;
+  for (const Benchmark &benchmark : benchmarks_) {
+    std::vector<std::vector<int64_t>> arg_sets = benchmark.arg_sets_;
+    if (arg_sets.empty()) arg_sets.emplace_back();
+    for (const std::vector<int64_t> &args : arg_sets) {
+      if (std::regex_search(benchmark.RunName(args), pattern)) runs.emplace_back(&benchmark, args);
+    }
+  }
+  if (runs.empty()) {
+    std::fprintf(stderr, "No benchmarks matched the filter %s (see --list)\n", filter.c_str());
+    return 1;
+  }
+  if (list) {
+    for (const auto &[benchmark, args] : runs) {
+      std::printf("%s\n", benchmark->RunName(args).c_str());
+    }
+    return 0;
+  }
+
+  if (format == "console") {
+    std::printf("%-60s %15s %15s %12s  %s\n", "Benchmark", "Time", "CPU", "Iterations", "Throughput");
+  } else if (format == "csv") {
+    std::printf("name,iterations,real_time,cpu_time,time_unit,bytes_per_second,items_per_second,label\n");
+  }
+  std::vector<Result> results;
+  for (const auto &[benchmark, args] : runs) {
+    Result result = Measure(*benchmark, args, min_time);
+    if (format == "console") {
+      std::printf("%-60s %12.0f ns %12.0f ns %12lld ", result.name.c_str(), result.real_ns, result.cpu_ns,
+                  static_cast<long long>(result.iterations));
+      if (result.bytes_per_second > 0.0) std::printf(" %9.2f MB/s", result.bytes_per_second / 1e6);
+      if (result.items_per_second > 0.0) std::printf(" %10.4g items/s", result.items_per_second);
+      if (!result.label.empty()) std::printf(" %s", result.label.c_str());
+      std::printf("\n");
+      std::fflush(stdout);
+    } else if (format == "csv") {
+      std::printf("\"%s\",%lld,%.3f,%.3f,ns,%.6g,%.6g,\"%s\"\n", result.name.c_str(),
+                  static_cast<long long>(result.iterations), result.real_ns, result.cpu_ns, result.bytes_per_second,
+                  result.items_per_second, result.label.c_str());
+    }
+    results.push_back(result);
+  }
+  if (format == "json") PrintJson(argv[0], results);
+  return 0;
+}
+
+#endif
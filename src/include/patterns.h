@@ -0,0 +1,100 @@
+/**
+ * This header file holds the table of local patterns behind the pair reasoning of the solver.
+ *
+ * Two numbers whose neighbourhoods overlap prove something only through the shape of the overlap: how many unknown
+ * blocks only the first one sees, only the second one sees and both see, and how many mines each still needs. 1-2-1,
+ * 1-2-2-1 and the 1-1 against a wall are all such shapes. The table holds what every shape proves, so the pair loop
+ * reads one entry instead of walking the rules case by case. It is built at compile time by running the rules over
+ * every shape, which keeps the table and the rules the same by construction.
+ */
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include <array>
+#include <cstdint>
+
+// What a pair of numbers proves, as bits of a PairTable entry: the unique blocks of the first number or of the second
+// number are all safe or all mines
+constexpr uint8_t kFirstSafe = 1;
+constexpr uint8_t kFirstMine = 2;
+constexpr uint8_t kSecondSafe = 4;
+constexpr uint8_t kSecondMine = 8;
+
+/**
+ * @brief The pair rules of Solver::SolveConstraints() for one shape.
+ * @details unique_first and unique_second are the unknown blocks only the first or the second number sees, common the
+ * ones both see, and remaining_first and remaining_second the mines each number still needs.
+ */
+constexpr uint8_t PairRule(int unique_first, int unique_second, int common, int remaining_first,
+                           int remaining_second) {
+  uint8_t proven = 0;
+  // Subset: the first number's unknowns are all among the second's
+  if (unique_first == 0 && unique_second > 0) {
+    // If first needs all its unknowns to be mines, second's unique cells are safe
+    if (remaining_first == common) proven |= kSecondSafe;
+    // If first needs no mines, all second's unique must have all remaining mines
+    if (remaining_first == 0 && remaining_second == unique_second) proven |= kSecondMine;
+  }
+  // Symmetric case: second's unknowns are all among the first's
+  if (unique_second == 0 && unique_first > 0) {
+    if (remaining_second == common) proven |= kFirstSafe;
+    if (remaining_second == 0 && remaining_first == unique_first) proven |= kFirstMine;
+  }
+  // Overlapping sets: the difference of the mine counts can fill the unique cells of one side
+  if (unique_first > 0 && unique_second > 0 && common > 0) {
+    int mine_diff = remaining_second - remaining_first;
+    if (mine_diff == unique_second) proven |= kSecondMine | kFirstSafe;
+    if (-mine_diff == unique_first) proven |= kFirstMine | kSecondSafe;
+  }
+  return proven;
+}
+
+/**
+ * @brief What PairRule() proves for every shape two numbers can have.
+ * @details A number has at most 8 unknown neighbours and needs at most 8 more mines, so every count is in [0, 8] and
+ * the table has 9^5 one-byte entries.
+ */
+struct PairTable {
+  static constexpr int kCounts = 9;
+  static constexpr int kEntries = kCounts * kCounts * kCounts * kCounts * kCounts;
+
+  static constexpr int Index(int unique_first, int unique_second, int common, int remaining_first,
+                             int remaining_second) {
+    return (((unique_first * kCounts + unique_second) * kCounts + common) * kCounts + remaining_first) * kCounts +
+           remaining_second;
+  }
+
+  std::array<uint8_t, kEntries> proven;
+};
+
+constexpr PairTable MakePairTable() {
+  PairTable table{};
+  for (int unique_first = 0; unique_first < PairTable::kCounts; unique_first++) {
+    for (int unique_second = 0; unique_second < PairTable::kCounts; unique_second++) {
+      for (int common = 0; common < PairTable::kCounts; common++) {
+        for (int remaining_first = 0; remaining_first < PairTable::kCounts; remaining_first++) {
+          for (int remaining_second = 0; remaining_second < PairTable::kCounts; remaining_second++) {
+            table.proven[PairTable::Index(unique_first, unique_second, common, remaining_first, remaining_second)] =
+                PairRule(unique_first, unique_second, common, remaining_first, remaining_second);
+          }
+        }
+      }
+    }
+  }
+  return table;
+}
+
+inline constexpr PairTable kPairTable = MakePairTable();
+
+// What the pair of numbers with the given shape proves. A number that needs a negative number of mines or more mines
+// than there are blocks around it only comes from an inconsistent map, which proves nothing.
+inline uint8_t PairDeductions(int unique_first, int unique_second, int common, int remaining_first,
+                              int remaining_second) {
+  if (static_cast<unsigned>(remaining_first) >= PairTable::kCounts ||
+      static_cast<unsigned>(remaining_second) >= PairTable::kCounts) {
+    return 0;
+  }
+  return kPairTable.proven[PairTable::Index(unique_first, unique_second, common, remaining_first, remaining_second)];
+}
+
+#endif
@@ -0,0 +1,521 @@
+/**
+ * This header file holds the exact mine probability engine of the client.
+ *
+ * The unknown blocks next to a revealed number form the frontier. Every revealed number says how many mines are among
+ * its unknown neighbours, so the frontier is a system of constraints "sum of these blocks = k" over 0/1 variables. The
+ * engine splits the frontier into independent components, counts the solutions of each component by its number of
+ * mines with backtracking, and combines the components with the unknown blocks away from the frontier through the
+ * total number of mines: a way to place s mines on the frontier leaves C(outside, remaining - s) ways for the rest.
+ *
+ * With KeepSolutions(), the engine also keeps every solution it enumerates, so that Sample() can draw whole
+ * placements of the mines, each consistent placement with the same probability.
+ *
+ * The counts of a component only depend on its constraints, not on where it lies or on the rest of the map, and the
+ * same small components come back move after move and game after game. The engine therefore caches them by a canonical
+ * form: the constraints in the order they were given, over the variables numbered in search order. The constraints
+ * come sorted by position and list their variables in a fixed neighbour order, so a component has the same form
+ * wherever it is. A component whose numbers or unknown blocks changed has a different form, which is all the
+ * invalidation the cache needs.
+ */
+#ifndef PROBABILITY_H
+#define PROBABILITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.h"
+
+// "The mines among variables add up to mines"
+struct Constraint {
+  std::vector<int> variables;
+  int mines;
+};
+
+class ProbabilityEngine {
+ public:
+  /**
+   * @brief Compute the probability of a mine for every variable and for every block away from the frontier
+   *
+   * @param variables The number of frontier blocks, numbered from 0.
+   * @param constraints The constraints over them. Every variable should appear in at least one constraint.
+   * @param outside The number of unknown blocks that are not on the frontier.
+   * @param remaining_mines The number of mines that are not known yet.
+   * @return false if a component has too many solutions to enumerate within the budget, or if no placement of the
+   * mines is consistent. The probabilities are meaningless then.
+   */
+  bool Solve(int variables, const std::vector<Constraint> &constraints, int outside, int remaining_mines);
+
+  double Probability(int variable) const { return probability_[variable]; }
+  double OutsideProbability() const { return outside_probability_; }
+  // True if variable is a mine, or is safe, in every consistent placement
+  bool IsCertainMine(int variable) const { return safe_weight_[variable] == 0.0; }
+  bool IsCertainSafe(int variable) const { return mine_weight_[variable] == 0.0; }
+
+  // Keep up to limit solutions over all components in the next Solve() calls, for Sample(). 0 keeps none.
+  void KeepSolutions(size_t limit) { solution_limit_ = limit; }
+  // True if the last Solve() succeeded and kept all the solutions
+  bool CanSample() const { return can_sample_; }
+  /**
+   * @brief Draw a placement of the mines uniformly among all the placements consistent with the constraints
+   * @details Sets frontier_mines[v] to 1 if variable v is a mine and to 0 otherwise, and returns the number of mines
+   * left for the blocks away from the frontier, which are equally likely to be anywhere there. Requires CanSample().
+   * Only reads the engine, so several threads may sample at once, each with its own generator.
+   */
+  int Sample(std::mt19937_64 &rng, uint8_t *frontier_mines) const;
+
+  // The maximum number of search nodes spent on one component
+  static constexpr int64_t kNodeBudget = 4000000;
+  // Components with fewer variables are enumerated faster than they are looked up
+  static constexpr size_t kMinCachedSize = 4;
+  // Counts kept in the cache before it is emptied and filled again
+  static constexpr size_t kCacheBudget = size_t{1} << 22;
+
+  // Components found in the cache, and enumerated, since the engine was created
+  int64_t CacheHits() const { return cache_hits_; }
+  int64_t CacheMisses() const { return cache_misses_; }
+
+ private:
+  struct Component {
+    std::vector<int> variables;    // In search order
+    std::vector<int> constraints;  // Indices into the constraint list
+    // solutions[k] is the number of solutions with k mines; cell_mines[k * size + v] counts those where the v-th
+    // variable of the component is a mine
+    std::vector<double> solutions;
+    std::vector<double> cell_mines;
+    // The kept solutions as bitsets of words() words over the variables, grouped by number of mines: the ones with k
+    // mines are [first_solution[k], first_solution[k + 1])
+    std::vector<uint64_t> solution_bits;
+    std::vector<uint32_t> first_solution;
+    std::vector<uint32_t> solution_mines;  // Per kept solution, in the order found, until they are grouped
+    // tail[t] weighs the ways to complete a placement with t mines on this component and the ones before it
+    std::vector<double> tail;
+
+    size_t words() const { return (variables.size() + 63) / 64; }
+  };
+
+  // A solved component, by canonical form
+  struct CachedComponent {
+    std::vector<int> form;
+    std::vector<double> solutions;
+    std::vector<double> cell_mines;
+    bool complete;  // False if the enumeration ran out of budget
+  };
+
+  void BuildComponents(int variables, const std::vector<Constraint> &constraints);
+  // Fill form_ with the canonical form of component and return its hash
+  uint64_t CanonicalForm(const Component &component, const std::vector<Constraint> &constraints);
+  bool Enumerate(Component &component, const std::vector<Constraint> &constraints);
+  void Search(Component &component, size_t depth, int mines);
+  // Sort the kept solutions of component by number of mines
+  static void GroupSolutions(Component &component);
+  // Log of the binomial coefficient C(n, k), or -infinity if it is 0. n must be below log_factorial_.size().
+  double LogChoose(int n, int k) const;
+
+  std::vector<Component> components_;
+  // log(n!) for every n up to the largest board seen. std::lgamma() would do, but it writes the global signgam, which
+  // is a data race with solvers on several threads.
+  std::vector<double> log_factorial_{0.0};
+  std::vector<int> component_of_;  // Per variable
+  std::vector<int> parent_;        // Union-find over the variables
+
+  // Search state, indexed by constraint or by variable
+  std::vector<std::vector<int>> constraints_of_;  // Constraints each variable takes part in
+  std::vector<int> target_;                       // Mines each constraint still needs
+  std::vector<int> unassigned_;                   // Variables of each constraint not assigned yet
+  std::vector<uint8_t> value_;                    // Current assignment of each variable
+  int64_t nodes_ = 0;
+  size_t solution_limit_ = 0;
+  size_t kept_ = 0;      // Solutions kept by the current Solve()
+  bool keeping_ = false;  // Still keeping solutions: none was dropped yet
+  bool can_sample_ = false;
+  int remaining_mines_ = 0;
+
+  std::unordered_map<uint64_t, CachedComponent> cache_;
+  size_t cached_counts_ = 0;  // Doubles held by cache_
+  std::vector<int> form_;
+  std::vector<int> position_;  // Per variable, its index in its component
+  int64_t cache_hits_ = 0;
+  int64_t cache_misses_ = 0;
+
+  std::vector<double> probability_;
+  std::vector<double> mine_weight_;
+  std::vector<double> safe_weight_;
+  double outside_probability_ = 0.0;
+};
+
+inline double ProbabilityEngine::LogChoose(int n, int k) const {
+  if (k < 0 || k > n) return -std::numeric_limits<double>::infinity();
+  return log_factorial_[n] - log_factorial_[k] - log_factorial_[n - k];
+}
+
+inline void ProbabilityEngine::BuildComponents(int variables, const std::vector<Constraint> &constraints) {
+  parent_.resize(variables);
+  std::iota(parent_.begin(), parent_.end(), 0);
+  auto find = [this](int v) {
+    while (parent_[v] != v) {
+      parent_[v] = parent_[parent_[v]];
+      v = parent_[v];
+    }
+    return v;
+  };
+  constraints_of_.assign(variables, {});
+  for (size_t k = 0; k < constraints.size(); k++) {
+    const std::vector<int> &cells = constraints[k].variables;
+    for (int v : cells) {
+      constraints_of_[v].push_back(static_cast<int>(k));
+      parent_[find(v)] = find(cells[0]);
+    }
+  }
+
+  // Number the components and list their variables in breadth-first order, so that consecutive variables of the
+  // search share constraints and contradictions show up early
+  components_.clear();
+  component_of_.assign(variables, -1);
+  std::vector<int> root_component(variables, -1);
+  std::vector<uint8_t> queued(variables, false);
+  std::vector<uint8_t> constraint_seen(constraints.size(), false);
+  // The searches start from the first variable of the first constraint not reached yet, so that the order does not
+  // depend on how the variables are numbered (see CanonicalForm())
+  std::vector<int> starts;
+  for (const Constraint &constraint : constraints) {
+    starts.insert(starts.end(), constraint.variables.begin(), constraint.variables.end());
+  }
+  for (int v = 0; v < variables; v++) {
+    starts.push_back(v);
+  }
+  for (int start : starts) {
+    if (queued[start]) continue;
+    int root = find(start);
+    if (root_component[root] == -1) {
+      root_component[root] = static_cast<int>(components_.size());
+      components_.emplace_back();
+    }
+    Component &component = components_[root_component[root]];
+    queued[start] = true;
+    size_t head = component.variables.size();
+    component.variables.push_back(start);
+    while (head < component.variables.size()) {
+      int v = component.variables[head++];
+      component_of_[v] = root_component[root];
+      for (int k : constraints_of_[v]) {
+        if (!constraint_seen[k]) {
+          constraint_seen[k] = true;
+          component.constraints.push_back(k);
+        }
+        for (int w : constraints[k].variables) {
+          if (!queued[w]) {
+            queued[w] = true;
+            component.variables.push_back(w);
+          }
+        }
+      }
+    }
+  }
+}
+
+inline void ProbabilityEngine::Search(Component &component, size_t depth, int mines) {
+  if (++nodes_ > kNodeBudget) return;
+  if (depth == component.variables.size()) {
+    size_t size = component.variables.size();
+    component.solutions[mines] += 1.0;
+    double *row = component.cell_mines.data() + static_cast<size_t>(mines) * size;
+    for (size_t i = 0; i < size; i++) {
+      row[i] += value_[component.variables[i]];
+    }
+    if (keeping_) {
+      if (++kept_ > solution_limit_) {
+        keeping_ = false;
+        return;
+      }
+      size_t base = component.solution_bits.size();
+      component.solution_bits.resize(base + component.words(), 0);
+      for (size_t i = 0; i < size; i++) {
+        component.solution_bits[base + i / 64] |= static_cast<uint64_t>(value_[component.variables[i]]) << (i % 64);
+      }
+      component.solution_mines.push_back(static_cast<uint32_t>(mines));
+    }
+    return;
+  }
+  int v = component.variables[depth];
+  for (int value = 0; value <= 1; value++) {
+    // Assigning value must leave every constraint of v satisfiable: 0 <= target <= unassigned
+    bool feasible = true;
+    for (int k : constraints_of_[v]) {
+      int target = target_[k] - value;
+      if (target < 0 || target > unassigned_[k] - 1) {
+        feasible = false;
+        break;
+      }
+    }
+    if (!feasible) continue;
+    value_[v] = static_cast<uint8_t>(value);
+    for (int k : constraints_of_[v]) {
+      target_[k] -= value;
+      unassigned_[k]--;
+    }
+    Search(component, depth + 1, mines + value);
+    for (int k : constraints_of_[v]) {
+      target_[k] += value;
+      unassigned_[k]++;
+    }
+  }
+}
+
+inline uint64_t ProbabilityEngine::CanonicalForm(const Component &component,
+                                                const std::vector<Constraint> &constraints) {
+  position_.resize(parent_.size());
+  for (size_t i = 0; i < component.variables.size(); i++) {
+    position_[component.variables[i]] = static_cast<int>(i);
+  }
+  form_.clear();
+  form_.push_back(static_cast<int>(component.variables.size()));
+  for (int k : component.constraints) {
+    const Constraint &constraint = constraints[k];
+    form_.push_back(constraint.mines);
+    form_.push_back(static_cast<int>(constraint.variables.size()));
+    for (int v : constraint.variables) {
+      form_.push_back(position_[v]);
+    }
+  }
+  // FNV-1a over the words
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int word : form_) {
+    hash = (hash ^ static_cast<uint32_t>(word)) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline bool ProbabilityEngine::Enumerate(Component &component, const std::vector<Constraint> &constraints) {
+  size_t size = component.variables.size();
+  // Kept solutions are not cached, so a component that keeps them is always enumerated
+  bool cacheable = !keeping_ && size >= kMinCachedSize;
+  uint64_t hash = 0;
+  if (cacheable) {
+    hash = CanonicalForm(component, constraints);
+    auto found = cache_.find(hash);
+    bool hit = found != cache_.end() && found->second.form == form_;
+    TRACE_COUNT("component_cache_hit", hit);
+    if (hit) {
+      cache_hits_++;
+      const CachedComponent &cached = found->second;
+      if (!cached.complete) return false;
+      component.solutions = cached.solutions;
+      component.cell_mines = cached.cell_mines;
+      return true;
+    }
+    cache_misses_++;
+  }
+
+  component.solutions.assign(size + 1, 0.0);
+  component.cell_mines.assign((size + 1) * size, 0.0);
+  for (int k : component.constraints) {
+    target_[k] = constraints[k].mines;
+    unassigned_[k] = static_cast<int>(constraints[k].variables.size());
+  }
+  component.solution_bits.clear();
+  component.solution_mines.clear();
+  nodes_ = 0;
+  Search(component, 0, 0);
+  if (keeping_) GroupSolutions(component);
+  bool complete = nodes_ <= kNodeBudget;
+
+  if (cacheable) {
+    size_t counts = complete ? component.solutions.size() + component.cell_mines.size() : 0;
+    if (cached_counts_ + counts > kCacheBudget) {
+      cache_.clear();
+      cached_counts_ = 0;
+    }
+    // A colliding entry of another form is replaced
+    CachedComponent &cached = cache_[hash];
+    cached_counts_ -= cached.solutions.size() + cached.cell_mines.size();
+    cached.form = form_;
+    cached.complete = complete;
+    if (complete) {
+      cached.solutions = component.solutions;
+      cached.cell_mines = component.cell_mines;
+    } else {
+      cached.solutions.clear();
+      cached.cell_mines.clear();
+    }
+    cached_counts_ += counts;
+  }
+  return complete;
+}
+
+inline void ProbabilityEngine::GroupSolutions(Component &component) {
+  size_t size = component.variables.size();
+  size_t words = component.words();
+  component.first_solution.assign(size + 2, 0);
+  for (uint32_t mines : component.solution_mines) {
+    component.first_solution[mines + 1]++;
+  }
+  for (size_t k = 1; k < component.first_solution.size(); k++) {
+    component.first_solution[k] += component.first_solution[k - 1];
+  }
+  std::vector<uint32_t> next(component.first_solution.begin(), component.first_solution.end() - 1);
+  std::vector<uint64_t> grouped(component.solution_bits.size());
+  for (size_t n = 0; n < component.solution_mines.size(); n++) {
+    uint32_t slot = next[component.solution_mines[n]]++;
+    std::copy_n(component.solution_bits.begin() + n * words, words, grouped.begin() + slot * words);
+  }
+  component.solution_bits.swap(grouped);
+}
+
+inline bool ProbabilityEngine::Solve(int variables, const std::vector<Constraint> &constraints, int outside,
+                                     int remaining_mines) {
+  TRACE_SCOPE("ProbabilityEngine::Solve");
+  BuildComponents(variables, constraints);
+  target_.assign(constraints.size(), 0);
+  unassigned_.assign(constraints.size(), 0);
+  value_.assign(variables, 0);
+  kept_ = 0;
+  keeping_ = solution_limit_ > 0;
+  can_sample_ = false;
+  remaining_mines_ = remaining_mines;
+  for (Component &component : components_) {
+    if (!Enumerate(component, constraints)) return false;
+  }
+
+  // Weight of putting s mines on the frontier: the ways to place the rest outside, relative to the largest one
+  for (int n = static_cast<int>(log_factorial_.size()); n <= outside; n++) {
+    log_factorial_.push_back(log_factorial_.back() + std::log(static_cast<double>(n)));
+  }
+  int frontier_max = variables;
+  std::vector<double> log_outside(frontier_max + 1);
+  double log_max = -std::numeric_limits<double>::infinity();
+  for (int s = 0; s <= frontier_max; s++) {
+    log_outside[s] = LogChoose(outside, remaining_mines - s);
+    log_max = std::max(log_max, log_outside[s]);
+  }
+  if (std::isinf(log_max)) return false;
+  std::vector<double> outside_weight(frontier_max + 1);
+  for (int s = 0; s <= frontier_max; s++) {
+    outside_weight[s] = std::exp(log_outside[s] - log_max);
+  }
+
+  // Distribution of the number of frontier mines over all components except one, for every component. The values
+  // are rescaled as they go since only their ratios matter.
+  auto convolve = [](const std::vector<double> &a, const std::vector<double> &b) {
+    std::vector<double> result(a.size() + b.size() - 1, 0.0);
+    for (size_t i = 0; i < a.size(); i++) {
+      if (a[i] == 0.0) continue;
+      for (size_t j = 0; j < b.size(); j++) {
+        result[i + j] += a[i] * b[j];
+      }
+    }
+    double scale = *std::max_element(result.begin(), result.end());
+    if (scale > 0.0) {
+      for (double &x : result) x /= scale;
+    }
+    return result;
+  };
+  size_t count = components_.size();
+  std::vector<std::vector<double>> prefix(count + 1, std::vector<double>{1.0});
+  std::vector<std::vector<double>> suffix(count + 1, std::vector<double>{1.0});
+  for (size_t i = 0; i < count; i++) {
+    prefix[i + 1] = convolve(prefix[i], components_[i].solutions);
+  }
+  for (size_t i = count; i > 0; i--) {
+    suffix[i - 1] = convolve(suffix[i], components_[i - 1].solutions);
+  }
+
+  // Total weight, and the expected number of mines outside
+  const std::vector<double> &all = prefix[count];
+  double total = 0.0;
+  double outside_mines = 0.0;
+  for (size_t s = 0; s < all.size(); s++) {
+    double weight = all[s] * outside_weight[s];
+    total += weight;
+    outside_mines += weight * (remaining_mines - static_cast<int>(s));
+  }
+  if (total <= 0.0) return false;
+  outside_probability_ = outside > 0 ? outside_mines / total / outside : 0.0;
+
+  probability_.assign(variables, 0.0);
+  mine_weight_.assign(variables, 0.0);
+  safe_weight_.assign(variables, 0.0);
+  for (size_t i = 0; i < count; i++) {
+    const Component &component = components_[i];
+    std::vector<double> others = convolve(prefix[i], suffix[i + 1]);
+    // others was rescaled differently from all, so normalise against its own total
+    size_t size = component.variables.size();
+    double component_total = 0.0;
+    std::vector<double> weight_of_k(size + 1, 0.0);
+    for (size_t k = 0; k <= size; k++) {
+      if (component.solutions[k] == 0.0) continue;
+      for (size_t s = 0; s < others.size(); s++) {
+        weight_of_k[k] += others[s] * outside_weight[s + k];
+      }
+      component_total += component.solutions[k] * weight_of_k[k];
+    }
+    for (size_t v = 0; v < size; v++) {
+      double mine = 0.0;
+      double safe = 0.0;
+      for (size_t k = 0; k <= size; k++) {
+        double mines_here = component.cell_mines[k * size + v];
+        mine += mines_here * weight_of_k[k];
+        safe += (component.solutions[k] - mines_here) * weight_of_k[k];
+      }
+      int variable = component.variables[v];
+      mine_weight_[variable] = mine;
+      safe_weight_[variable] = safe;
+      probability_[variable] = component_total > 0.0 ? mine / component_total : 0.0;
+    }
+  }
+
+  // For sampling, the components are drawn one after another: with t mines on the ones before, component i gets k
+  // mines with a weight of solutions[k] times the ways to place the rest, sum over s of suffix[i + 1][s] *
+  // outside_weight[t + k + s]
+  if (keeping_) {
+    for (size_t i = 0; i < count; i++) {
+      const std::vector<double> &rest = suffix[i + 1];
+      std::vector<double> &tail = components_[i].tail;
+      tail.assign(frontier_max + 1, 0.0);
+      for (int t = 0; t <= frontier_max; t++) {
+        for (size_t s = 0; s < rest.size() && t + s <= static_cast<size_t>(frontier_max); s++) {
+          tail[t] += rest[s] * outside_weight[t + s];
+        }
+      }
+    }
+  }
+  can_sample_ = keeping_;
+  return true;
+}
+
+inline int ProbabilityEngine::Sample(std::mt19937_64 &rng, uint8_t *frontier_mines) const {
+  int placed = 0;
+  for (const Component &component : components_) {
+    // Pick the number of mines of the component, then one of its solutions with that many
+    size_t size = component.variables.size();
+    double sum = 0.0;
+    for (size_t k = 0; k <= size && placed + k < component.tail.size(); k++) {
+      sum += component.solutions[k] * component.tail[placed + k];
+    }
+    double target = static_cast<double>(rng() >> 11) * 0x1.0p-53 * sum;
+    size_t mines = 0;
+    for (size_t k = 0; k <= size && placed + k < component.tail.size(); k++) {
+      double weight = component.solutions[k] * component.tail[placed + k];
+      if (weight == 0.0) continue;
+      mines = k;
+      if (target < weight) break;
+      target -= weight;
+    }
+    uint32_t first = component.first_solution[mines];
+    uint32_t choices = component.first_solution[mines + 1] - first;
+    size_t words = component.words();
+    const uint64_t *bits = component.solution_bits.data() + (first + rng() % choices) * words;
+    for (size_t v = 0; v < size; v++) {
+      frontier_mines[component.variables[v]] = static_cast<uint8_t>(bits[v / 64] >> (v % 64) & 1);
+    }
+    placed += static_cast<int>(mines);
+  }
+  return remaining_mines_ - placed;
+}
+
+#endif
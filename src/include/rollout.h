@@ -0,0 +1,277 @@
+/**
+ * This header file holds the rollout guesser, an optional last stage of the solver. When no block is certain, the
+ * probability engine says how likely every block is to be a mine, but not what a click would reveal. The guesser
+ * samples whole boards consistent with the map from the engine, plays each candidate click on every sampled board and
+ * counts the numbers it would show. Among the blocks that are about as safe as the safest one, it then picks the one
+ * most likely to make progress: to show a number that proves another block safe right away, so that the next move
+ * needs no guess. The entropy of the number shown can be weighed in as well, but did not win more games.
+ *
+ * A guess samples a fixed number of boards in chunks of kChunk, and every chunk draws from its own generator, seeded
+ * from the configured seed, the number of the guess in its game and the chunk alone. The counts are sums over the
+ * chunks, so a guess is the same whatever the number of threads, the order the chunks run in, the games played before
+ * or the load of the machine. A time cap can be set on top, at the price of that reproducibility.
+ */
+#ifndef ROLLOUT_H
+#define ROLLOUT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "board.h"
+#include "probability.h"
+#include "thread_pool.h"
+
+struct RolloutConfig {
+  bool enabled = false;
+  int threads = 1;                  // Threads sampling for one guess; 0 means one per hardware thread
+  int64_t max_samples = 4096;       // Boards sampled for one guess
+  double budget_ms = 0.0;           // If positive, stop sampling a guess after this time, even if that varies the guess
+  size_t solution_limit = 1 << 20;  // Solutions the engine may keep for sampling; beyond that, no rollout
+  double margin = 0.08;             // Candidates may be this much likelier to be a mine than the safest block
+  double progress_weight = 1.0;     // Worth of a click that surely proves another block safe, relative to surviving it
+  double information_weight = 0.0;  // Worth of one bit of expected information
+  uint64_t seed = 0;
+};
+
+// A block the guesser may click
+struct RolloutCandidate {
+  int r;
+  int c;
+  double probability;  // Of a mine, from the engine
+  uint16_t progress;   // Bit n is set if showing n would prove another block safe right away
+  // Filled by Evaluate(): how often the block would show each number, over the sampled boards where it is safe
+  int64_t shown[9];
+};
+
+class RolloutGuesser {
+ public:
+  RolloutGuesser() = default;
+  RolloutGuesser(const RolloutGuesser &) = delete;
+  RolloutGuesser &operator=(const RolloutGuesser &) = delete;
+
+  void Configure(const RolloutConfig &config);
+  const RolloutConfig &Config() const { return config_; }
+  // Number the guesses from the first again, so that the seeds of a game do not depend on the games played before it
+  void NewGame() { guesses_ = 0; }
+
+  /**
+   * @brief Sample boards consistent with map and count what every candidate would show on them
+   *
+   * @param engine The engine after a successful Solve() over frontier that kept its solutions (CanSample()).
+   * @param map The map as the client sees it. '@' blocks are taken to be mines.
+   * @param frontier The block of every variable of the engine.
+   * @param candidates Their shown counts are filled in.
+   * @return The number of boards sampled: max_samples, unless budget_ms cut the sampling short.
+   */
+  int64_t Evaluate(const ProbabilityEngine &engine, const Grid<char> &map,
+                   const std::vector<std::pair<int, int>> &frontier, std::vector<RolloutCandidate> &candidates);
+  /**
+   * @brief Index of the candidate with the best score after Evaluate()
+   * @details The score is the chance to survive the click times 1 + progress_weight * the chance that the number it
+   * shows makes progress + information_weight * the entropy in bits of that number. Equal scores go to the earlier
+   * candidate.
+   */
+  size_t Choose(const std::vector<RolloutCandidate> &candidates) const;
+  // Boards sampled and seconds spent by Evaluate() since Configure()
+  int64_t TotalSamples() const { return total_samples_; }
+  double TotalSeconds() const { return total_seconds_; }
+
+ private:
+  // The state of one sampling thread. The board has a border without mines, so that no neighbour needs a bounds check.
+  struct alignas(64) Worker {
+    std::mt19937_64 rng;
+    Grid<uint8_t> mines;
+    std::vector<uint8_t> frontier_mines;
+    std::vector<int> outside;  // A copy of outside_offsets_, shuffled in place by every sample of a chunk
+    std::vector<int64_t> shown;
+    int64_t samples = 0;
+  };
+
+  static constexpr int64_t kChunk = 64;  // Boards sampled from one seed
+
+  // Sample count boards of chunk on worker, with the generator of that chunk
+  void Sample(Worker &worker, const ProbabilityEngine &engine, uint64_t chunk, int64_t count) const;
+
+  RolloutConfig config_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::vector<Worker> workers_;
+  uint64_t guesses_ = 0;  // Guesses evaluated in this game, to give every guess its own seeds
+  int64_t total_samples_ = 0;
+  double total_seconds_ = 0.0;
+
+  // Evaluate() state shared by the workers, as offsets into their bordered boards
+  std::vector<int> frontier_offsets_;
+  std::vector<int> candidate_offsets_;
+  std::vector<int> outside_offsets_;  // The unknown blocks away from the frontier
+};
+
+inline void RolloutGuesser::Configure(const RolloutConfig &config) {
+  config_ = config;
+  pool_.reset();
+  if (config_.enabled && config_.threads != 1) {
+    pool_.reset(new ThreadPool(config_.threads));
+  }
+  workers_.clear();
+  workers_.resize(pool_ ? pool_->Size() : 1);
+  guesses_ = 0;
+  total_samples_ = 0;
+  total_seconds_ = 0.0;
+}
+
+inline void RolloutGuesser::Sample(Worker &worker, const ProbabilityEngine &engine, uint64_t chunk,
+                                   int64_t count) const {
+  worker.rng.seed(config_.seed ^ (guesses_ * 0x9e3779b97f4a7c15ULL) ^ ((chunk + 1) * 0xbf58476d1ce4e5b9ULL));
+  // The shuffle picks its mines by position, so every chunk starts from the same order
+  worker.outside = outside_offsets_;
+  uint8_t *mines = worker.mines.Data();
+  int outside = static_cast<int>(worker.outside.size());
+  const int *neighbours = worker.mines.Neighbours();
+  size_t candidates = candidate_offsets_.size();
+  for (int64_t sample = 0; sample < count; sample++) {
+    int outside_mines = std::min(engine.Sample(worker.rng, worker.frontier_mines.data()), outside);
+    for (size_t v = 0; v < frontier_offsets_.size(); v++) {
+      mines[frontier_offsets_[v]] = worker.frontier_mines[v];
+    }
+    // A partial Fisher-Yates shuffle: the first outside_mines blocks are a uniform choice, whatever the order before
+    for (int k = 0; k < outside_mines; k++) {
+      int pick = k + static_cast<int>(worker.rng() % static_cast<uint64_t>(outside - k));
+      std::swap(worker.outside[k], worker.outside[pick]);
+      mines[worker.outside[k]] = 1;
+    }
+
+    for (size_t i = 0; i < candidates; i++) {
+      int offset = candidate_offsets_[i];
+      if (mines[offset]) continue;
+      int count = 0;
+      for (int k = 0; k < 8; k++) {
+        count += mines[offset + neighbours[k]];
+      }
+      worker.shown[i * 9 + count]++;
+    }
+
+    for (int k = 0; k < outside_mines; k++) {
+      mines[worker.outside[k]] = 0;
+    }
+  }
+  worker.samples += count;
+  for (int offset : frontier_offsets_) {
+    mines[offset] = 0;
+  }
+}
+
+inline int64_t RolloutGuesser::Evaluate(const ProbabilityEngine &engine, const Grid<char> &map,
+                                        const std::vector<std::pair<int, int>> &frontier,
+                                        std::vector<RolloutCandidate> &candidates) {
+  auto start = std::chrono::steady_clock::now();
+  bool capped = config_.budget_ms > 0.0;
+  auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double, std::milli>(capped ? config_.budget_ms : 0.0));
+  int rows = map.Rows();
+  int columns = map.Columns();
+  Worker &first = workers_[0];
+  first.mines.ResizeBordered(rows, columns, 0, 0);
+  auto offset = [&first](int r, int c) { return static_cast<int>(first.mines.Offset(r, c)); };
+  frontier_offsets_.clear();
+  for (auto [r, c] : frontier) {
+    frontier_offsets_.push_back(offset(r, c));
+  }
+  candidate_offsets_.clear();
+  for (const RolloutCandidate &candidate : candidates) {
+    candidate_offsets_.push_back(offset(candidate.r, candidate.c));
+  }
+
+  // Every worker starts from the known mines, with the frontier blocks and the outside blocks to be filled in
+  Grid<uint8_t> on_frontier(rows, columns, false);
+  for (auto [r, c] : frontier) {
+    on_frontier[r][c] = true;
+  }
+  outside_offsets_.clear();
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      if (map[i][j] == '@') {
+        first.mines[i][j] = 1;
+      } else if (map[i][j] == '?' && !on_frontier[i][j]) {
+        outside_offsets_.push_back(offset(i, j));
+      }
+    }
+  }
+  guesses_++;
+  for (size_t k = 0; k < workers_.size(); k++) {
+    Worker &worker = workers_[k];
+    if (k > 0) {
+      worker.mines = first.mines;
+    }
+    worker.frontier_mines.assign(frontier.size(), 0);
+    worker.shown.assign(candidates.size() * 9, 0);
+    worker.samples = 0;
+  }
+
+  size_t chunks = static_cast<size_t>((std::max<int64_t>(config_.max_samples, 0) + kChunk - 1) / kChunk);
+  auto run_chunk = [&](size_t chunk, Worker &worker) {
+    if (capped && std::chrono::steady_clock::now() > deadline) return;
+    int64_t count = std::min(kChunk, config_.max_samples - static_cast<int64_t>(chunk) * kChunk);
+    Sample(worker, engine, chunk, count);
+  };
+  if (pool_) {
+    pool_->Run(chunks, [&](size_t chunk, int worker) { run_chunk(chunk, workers_[worker]); });
+  } else {
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+      run_chunk(chunk, first);
+    }
+  }
+
+  int64_t samples = 0;
+  for (RolloutCandidate &candidate : candidates) {
+    std::fill(candidate.shown, candidate.shown + 9, 0);
+  }
+  for (const Worker &worker : workers_) {
+    samples += worker.samples;
+    for (size_t i = 0; i < candidates.size(); i++) {
+      for (int n = 0; n < 9; n++) {
+        candidates[i].shown[n] += worker.shown[i * 9 + n];
+      }
+    }
+  }
+  total_samples_ += samples;
+  total_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return samples;
+}
+
+inline size_t RolloutGuesser::Choose(const std::vector<RolloutCandidate> &candidates) const {
+  size_t best = 0;
+  double best_score = -1.0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const RolloutCandidate &candidate = candidates[i];
+    int64_t safe = 0;
+    for (int64_t times : candidate.shown) {
+      safe += times;
+    }
+    double entropy = 0.0;
+    for (int64_t times : candidate.shown) {
+      if (times == 0) continue;
+      double share = static_cast<double>(times) / static_cast<double>(safe);
+      entropy -= share * std::log2(share);
+    }
+    double progress = 0.0;
+    for (int n = 0; n < 9; n++) {
+      if (candidate.progress >> n & 1) progress += static_cast<double>(candidate.shown[n]);
+    }
+    progress = safe > 0 ? progress / static_cast<double>(safe) : 0.0;
+    double score = (1.0 - candidate.probability) *
+                   (1.0 + config_.information_weight * entropy + config_.progress_weight * progress);
+    if (score > best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+#endif
@@ -1,8 +1,18 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <unistd.h>
+
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "map_parser.h"
+#include "trace.h"
 
 /*
  * You may need to define some global variables for the information of the game map here.
@@ -17,53 +27,43 @@ int total_mines;  // The count of mines of the game map. You MUST NOT modify its
 int game_state;  // The state of the game, 0 for continuing, 1 for winning, -1 for losing. You MUST NOT modify its name.
 
 // Additional global variables
-bool is_mine[35][35];      // True if the grid contains a mine
-bool is_visited[35][35];   // True if the grid has been visited
-bool is_marked[35][35];    // True if the grid has been marked as a mine
-int visit_count;           // Number of visited non-mine grids
-int marked_mine_count;     // Number of correctly marked mines
+Game game;                    // The game behind the functions below. It holds all the state of the map.
+bool exit_after_game = true;  // Whether ExitGame() ends the process. Set it to false to play several games in a run.
 
-// Helper function to count adjacent mines
-int CountAdjacentMines(int r, int c) {
-  int count = 0;
-  for (int dr = -1; dr <= 1; dr++) {
-    for (int dc = -1; dc <= 1; dc++) {
-      if (dr == 0 && dc == 0) continue;
-      int nr = r + dr;
-      int nc = c + dc;
-      if (nr >= 0 && nr < rows && nc >= 0 && nc < columns && is_mine[nr][nc]) {
-        count++;
-      }
-    }
-  }
-  return count;
+// Helper function to copy the state of the game into the global variables above
+void SyncGlobals() {
+  rows = game.Rows();
+  columns = game.Columns();
+  total_mines = game.TotalMines();
+  game_state = game.State();
 }
 
-// Helper function to visit a block (internal, recursive)
-void VisitBlockInternal(int r, int c) {
-  // Check bounds
-  if (r < 0 || r >= rows || c < 0 || c >= columns) return;
-
-  // If already visited or marked, do nothing
-  if (is_visited[r][c] || is_marked[r][c]) return;
-
-  // Mark as visited
-  is_visited[r][c] = true;
-
-  // If it's not a mine, increment visit count
-  if (!is_mine[r][c]) {
-    visit_count++;
-
-    // If mine count is 0, recursively visit all adjacent blocks
-    if (CountAdjacentMines(r, c) == 0) {
-      for (int dr = -1; dr <= 1; dr++) {
-        for (int dc = -1; dc <= 1; dc++) {
-          if (dr == 0 && dc == 0) continue;
-          VisitBlockInternal(r + dr, c + dc);
-        }
-      }
-    }
+/**
+ * @brief Helper function to load the map straight from a memory mapping of stdin
+ *
+ * @details This only works when stdin is a regular file that nobody has read from yet, and cin has not been redirected.
+ * The map is parsed in place, and the file offset is moved past it, so the operations that follow are read from cin
+ * as usual. Returns false without consuming anything if the map cannot be loaded this way.
+ */
+bool InitMapFromFile() {
+  if (dynamic_cast<std::stringbuf *>(std::cin.rdbuf()) != nullptr) return false;
+  if (lseek(STDIN_FILENO, 0, SEEK_CUR) != 0) return false;
+  MappedFile file;
+  if (!file.Open(STDIN_FILENO)) return false;
+  const char *cursor = file.Data();
+  const char *end = file.Data() + file.Size();
+  int n, m;
+  if (!ParseInt(cursor, end, n) || !ParseInt(cursor, end, m)) return false;
+  game.Reset(n, m);
+  std::string scratch;
+  for (int i = 0; i < n; i++) {
+    const char *row = ParseMapRow(cursor, end, m, scratch);
+    if (row == nullptr) return false;
+    game.LoadRow(i, row);
   }
+  game.Start();
+  lseek(STDIN_FILENO, cursor - file.Data(), SEEK_SET);
+  return true;
 }
 
 /**
@@ -79,27 +79,12 @@ void VisitBlockInternal(int r, int c) {
  * would be initialized, with all the blocks unvisited.
  */
 void InitMap() {
-  std::cin >> rows >> columns;
-
-  // Initialize variables
-  total_mines = 0;
-  game_state = 0;
-  visit_count = 0;
-  marked_mine_count = 0;
-
-  // Read the map and initialize arrays
-  for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      char c;
-      std::cin >> c;
-      is_mine[i][j] = (c == 'X');
-      is_visited[i][j] = false;
-      is_marked[i][j] = false;
-      if (is_mine[i][j]) {
-        total_mines++;
-      }
-    }
+  if (!InitMapFromFile()) {
+    int n, m;
+    std::cin >> n >> m;
+    game.Read(n, m, std::cin);
   }
+  SyncGlobals();
 }
 
 /**
@@ -133,25 +118,8 @@ void InitMap() {
  * @note For invalid operation, you should not do anything.
  */
 void VisitBlock(int r, int c) {
-  // Check bounds
-  if (r < 0 || r >= rows || c < 0 || c >= columns) return;
-
-  // If already visited or marked, do nothing
-  if (is_visited[r][c] || is_marked[r][c]) return;
-
-  // Visit the block using internal function
-  VisitBlockInternal(r, c);
-
-  // Check if we hit a mine
-  if (is_mine[r][c]) {
-    game_state = -1; // Game over
-    return;
-  }
-
-  // Check if we won (all non-mine grids are visited)
-  if (visit_count == rows * columns - total_mines) {
-    game_state = 1; // Win
-  }
+  game.VisitBlock(r, c);
+  SyncGlobals();
 }
 
 /**
@@ -188,26 +156,8 @@ void VisitBlock(int r, int c) {
  * @note For invalid operation, you should not do anything.
  */
 void MarkMine(int r, int c) {
-  // Check bounds
-  if (r < 0 || r >= rows || c < 0 || c >= columns) return;
-
-  // If already visited or marked, do nothing
-  if (is_visited[r][c] || is_marked[r][c]) return;
-
-  // Mark the block
-  is_marked[r][c] = true;
-
-  // Check if it's actually a mine
-  if (is_mine[r][c]) {
-    marked_mine_count++;
-    // Check if we won (all non-mine grids are visited)
-    if (visit_count == rows * columns - total_mines) {
-      game_state = 1; // Win
-    }
-  } else {
-    // Marked a non-mine, game over
-    game_state = -1;
-  }
+  game.MarkMine(r, c);
+  SyncGlobals();
 }
 
 /**
@@ -227,39 +177,8 @@ void MarkMine(int r, int c) {
  * And the game ends (and player wins).
  */
 void AutoExplore(int r, int c) {
-  // Check bounds
-  if (r < 0 || r >= rows || c < 0 || c >= columns) return;
-
-  // Can only auto-explore visited non-mine grids
-  if (!is_visited[r][c] || is_mine[r][c]) return;
-
-  // Count marked mines around this grid
-  int marked_count = 0;
-  for (int dr = -1; dr <= 1; dr++) {
-    for (int dc = -1; dc <= 1; dc++) {
-      if (dr == 0 && dc == 0) continue;
-      int nr = r + dr;
-      int nc = c + dc;
-      if (nr >= 0 && nr < rows && nc >= 0 && nc < columns && is_marked[nr][nc]) {
-        marked_count++;
-      }
-    }
-  }
-
-  // If marked count equals the mine count, visit all non-marked neighbors
-  int mine_count = CountAdjacentMines(r, c);
-  if (marked_count == mine_count) {
-    for (int dr = -1; dr <= 1; dr++) {
-      for (int dc = -1; dc <= 1; dc++) {
-        if (dr == 0 && dc == 0) continue;
-        int nr = r + dr;
-        int nc = c + dc;
-        if (nr >= 0 && nr < rows && nc >= 0 && nc < columns && !is_marked[nr][nc]) {
-          VisitBlock(nr, nc);
-        }
-      }
-    }
-  }
+  game.AutoExplore(r, c);
+  SyncGlobals();
 }
 
 /**
@@ -272,16 +191,32 @@ void AutoExplore(int r, int c) {
  * @note If the player wins, we consider that ALL mines are correctly marked.
  */
 void ExitGame() {
-  // Output the result
-  if (game_state == 1) {
-    std::cout << "YOU WIN!" << std::endl;
-    // When winning, all mines are considered correctly marked
-    std::cout << visit_count << " " << total_mines << std::endl;
-  } else {
-    std::cout << "GAME OVER!" << std::endl;
-    std::cout << visit_count << " " << marked_mine_count << std::endl;
+  game.PrintResult(std::cout);
+  TRACE_DUMP();
+  if (exit_after_game) {
+    exit(0);  // Exit the game immediately
   }
-  exit(0);  // Exit the game immediately
+}
+
+// Helper functions to try operations on the real state and take them back. RestoreCheckpoint() costs time proportional
+// to the blocks changed since SaveCheckpoint() (see Game::Rollback()).
+GameCheckpoint SaveCheckpoint() {
+  return game.Checkpoint();
+}
+
+void RestoreCheckpoint(const GameCheckpoint &checkpoint) {
+  game.Rollback(checkpoint);
+  SyncGlobals();
+}
+
+// Helper function to get the symbol PrintMap shows for a block
+char BlockSymbol(int r, int c) {
+  return game.Symbol(r, c);
+}
+
+// Helper function to bring the printed map up to date. Returns the blocks whose symbol changed since the last print.
+const std::vector<std::pair<int, int>> &CollectDirtyBlocks() {
+  return game.CollectDirtyBlocks();
 }
 
 /**
@@ -307,43 +242,29 @@ void ExitGame() {
  * (You may find the global variable game_state useful when implementing this function.)
  *
  * @note Use std::cout to print the game map, especially when you want to try the advanced task!!!
+ *
+ * @note The printed map is kept in frame. Only the blocks changed since the last print are redrawn, and the whole map
+ * is written with a single call.
  */
 void PrintMap() {
-  for (int i = 0; i < rows; i++) {
-    for (int j = 0; j < columns; j++) {
-      if (is_visited[i][j]) {
-        // Visited grid
-        if (is_mine[i][j]) {
-          std::cout << 'X';
-        } else {
-          // Show the mine count
-          std::cout << CountAdjacentMines(i, j);
-        }
-      } else if (is_marked[i][j]) {
-        // Marked grid
-        if (is_mine[i][j]) {
-          // When winning, show all mines as @
-          if (game_state == 1) {
-            std::cout << '@';
-          } else {
-            std::cout << '@';
-          }
-        } else {
-          // Marked a non-mine, show as X (causes failure)
-          std::cout << 'X';
-        }
-      } else {
-        // Unvisited and unmarked
-        // Special case: when winning, show all unmarked mines as @
-        if (game_state == 1 && is_mine[i][j]) {
-          std::cout << '@';
-        } else {
-          std::cout << '?';
-        }
-      }
-    }
-    std::cout << std::endl;
-  }
+  game.PrintMap(std::cout);
+}
+
+/**
+ * @brief The definition of function PrintDiff()
+ *
+ * @details This function is an alternative to PrintMap() for consumers that keep their own copy of the map. Instead
+ * of the whole map, it prints the number k of blocks whose symbol changed since the last print, followed by k lines
+ * "r c symbol" using the same symbols as PrintMap(). For the example above, visiting (2, 0) on a fresh map prints
+ *     4
+ *     2 0 0
+ *     2 1 1
+ *     1 1 2
+ *     1 0 1
+ * (The order of the blocks is unspecified.)
+ */
+void PrintDiff() {
+  game.PrintDiff(std::cout);
 }
 
 #endif
@@ -0,0 +1,671 @@
+/**
+ * This header file holds the solver behind client.h. All the knowledge of the client lives in a Solver object, which
+ * only sees the symbols of the map and answers with actions instead of calling Execute() itself. That way any number
+ * of solvers can play at the same time, each against its own Game.
+ */
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "bitboard.h"
+#include "board.h"
+#include "elimination.h"
+#include "patterns.h"
+#include "probability.h"
+#include "rollout.h"
+#include "trace.h"
+
+// One operation of the client. type is 0 to visit (r, c), 1 to mark it and 2 to auto-explore it, as in Execute().
+struct Action {
+  int r;
+  int c;
+  int type;
+};
+
+class Solver {
+ public:
+  // Forget the previous game and start a new one on a rows * columns map with total_mines mines, all unknown
+  void Reset(int rows, int columns, int total_mines);
+  // Record the symbol of one block, as PrintMap() shows it
+  void UpdateBlock(int r, int c, char symbol);
+  /**
+   * @brief Choose the next action. Returns false if there is nothing left to do.
+   * @details Every proven action found by a pass is queued, and the queue is drained before anything is recomputed.
+   * Queued actions stay correct whatever the other queued actions reveal, so the caller may run several of them
+   * before it passes the map back (see HasPendingActions()).
+   */
+  bool Decide(Action &action);
+  // True if Decide() still has proven actions queued, which need no new information from the map
+  bool HasPendingActions() const { return !pending_.empty(); }
+  // Run the pair reasoning over every number on the map, not only the ones that changed, and queue what it proves.
+  // Returns the number of queued actions.
+  size_t SolveAllPairs();
+  // Let the rollout guesser (see rollout.h) choose among the safest blocks when a guess is needed
+  void SetRollout(const RolloutConfig &config);
+  const RolloutGuesser &Rollout() const { return rollout_; }
+
+ private:
+  // Bits of queued_: which work queues hold a number
+  static constexpr uint8_t kObviousQueued = 1;
+  static constexpr uint8_t kPairQueued = 2;
+
+  // The symbol of the border around client_map_, which is neither unknown, marked nor a number
+  static constexpr char kBorder = '#';
+
+  static bool IsNumber(char symbol) { return symbol >= '0' && symbol <= '8'; }
+  // Helper function to count adjacent cells
+  void CountAdjacent(int r, int c, int &unknown, int &marked, int &total_adj) const;
+  // Put the number at (r, c) back on the work queues after its neighbourhood changed
+  void Enqueue(int r, int c);
+  // Add (r, c) to the frontier or remove it, whichever its symbol and neighbours call for
+  void UpdateFrontier(int r, int c);
+  // Queue a proven action, unless it is queued already
+  void Plan(int r, int c, int type);
+  // Take the next queued action that still does something
+  bool NextPlanned(Action &action);
+  // Queue every obvious safe cell or mine found around the numbers on obvious_queue_
+  void FindObviousMoves();
+  // Pairwise subset and difference reasoning between the numbers on pair_queue_ and the numbers around them, by the
+  // pattern table of patterns.h. Queues every cell it proves.
+  void SolveConstraints();
+  // Gaussian elimination over constraints_ and the total number of mines (see elimination.h). Queues every cell it
+  // proves.
+  void SolveLinear();
+  // Local estimate of the mine probability of a cell, used when the frontier is too large to enumerate
+  double CalculateMineProbability(int r, int c) const;
+  // Fill constraints_ with one constraint per number next to the frontier, in row-major order of the numbers
+  void BuildConstraints();
+  // Run the probability engine over constraints_. Returns false if it gave up.
+  bool ComputeProbabilities();
+  // Mine probability of the unknown block (r, c) after ComputeProbabilities(), and its score to break ties with
+  double GuessProbability(int r, int c, int &score) const;
+  // Bit n is set if the unknown block (r, c) showing n would prove another block safe right away
+  uint16_t ProgressValues(int r, int c) const;
+  // Pick among the blocks at most the margin less safe than min_probability by sampling boards
+  bool RolloutGuess(double min_probability, Action &action);
+  // Last resort: queue the cells the engine proved safe or mines, or else visit the safest cell. Needs constraints_
+  // built for the current map.
+  bool MakeGuess(Action &action);
+
+  int rows_ = 0;
+  int columns_ = 0;
+  int total_mines_ = 0;
+  // The grids read around a block have a border (see Grid::ResizeBordered()), so the neighbour loops need no bounds
+  // checks. The counters of the border are updated like the others and never read.
+  Grid<char> client_map_;  // Current state of the map
+
+  // Kept up to date by UpdateBlock(), so that a decision only looks at what changed since the last one
+  Grid<uint8_t> unknown_around_;  // Number of '?' neighbours
+  Grid<uint8_t> marked_around_;   // Number of '@' neighbours
+  Grid<uint8_t> numbers_around_;  // Number of revealed number neighbours
+  BitGrid unknown_bits_;          // The '?' blocks
+  BitGrid number_bits_;           // The revealed numbers
+  Grid<uint8_t> queued_;          // kObviousQueued | kPairQueued
+  Grid<int> frontier_index_;      // Index into frontier_ of every '?' next to a number, -1 elsewhere
+  std::vector<std::pair<int, int>> frontier_;
+  int unknown_total_ = 0;  // Number of '?' blocks
+  int marked_total_ = 0;   // Number of '@' blocks
+  // Numbers whose neighbourhood changed and may allow a deduction. A number leaves a queue once it allows none.
+  std::deque<std::pair<int, int>> obvious_queue_;
+  std::deque<std::pair<int, int>> pair_queue_;
+  std::deque<Action> pending_;  // Proven actions not taken yet
+  Grid<uint8_t> planned_;       // True if the block has an action in pending_
+
+  // Scratch space of SolveLinear() and ComputeProbabilities(), kept to reuse its storage
+  EliminationSolver elimination_;
+  ProbabilityEngine engine_;
+  std::vector<Constraint> constraints_;
+  std::vector<std::pair<int, int>> constraint_numbers_;
+  RolloutGuesser rollout_;
+  std::vector<RolloutCandidate> candidates_;
+};
+
+inline void Solver::Reset(int rows, int columns, int total_mines) {
+  rows_ = rows;
+  columns_ = columns;
+  total_mines_ = total_mines;
+  client_map_.ResizeBordered(rows, columns, '?', kBorder);
+  unknown_around_.ResizeBordered(rows, columns, 0, 0);
+  marked_around_.ResizeBordered(rows, columns, 0, 0);
+  numbers_around_.ResizeBordered(rows, columns, 0, 0);
+  queued_.Resize(rows, columns, 0);
+  frontier_index_.ResizeBordered(rows, columns, -1, -1);
+  planned_.Resize(rows, columns, false);
+  unknown_bits_.Resize(rows, columns);
+  number_bits_.Resize(rows, columns);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      unknown_bits_.Set(i, j);
+    }
+  }
+  unknown_bits_.CountNeighbours(unknown_around_);
+  frontier_.clear();
+  unknown_total_ = rows * columns;
+  marked_total_ = 0;
+  obvious_queue_.clear();
+  pair_queue_.clear();
+  pending_.clear();
+  rollout_.NewGame();
+}
+
+inline void Solver::SetRollout(const RolloutConfig &config) {
+  rollout_.Configure(config);
+  engine_.KeepSolutions(config.enabled ? config.solution_limit : 0);
+}
+
+inline void Solver::UpdateBlock(int r, int c, char symbol) {
+  char old_symbol = client_map_[r][c];
+  if (old_symbol == symbol) return;
+  client_map_[r][c] = symbol;
+
+  // Update the counters of the neighbours, and requeue the numbers among them
+  int unknown_delta = (symbol == '?') - (old_symbol == '?');
+  int marked_delta = (symbol == '@') - (old_symbol == '@');
+  int number_delta = IsNumber(symbol) - IsNumber(old_symbol);
+  unknown_total_ += unknown_delta;
+  marked_total_ += marked_delta;
+  if (symbol == '?') {
+    unknown_bits_.Set(r, c);
+  } else {
+    unknown_bits_.Reset(r, c);
+  }
+  if (IsNumber(symbol)) {
+    number_bits_.Set(r, c);
+  } else {
+    number_bits_.Reset(r, c);
+  }
+  for (int k = 0; k < 8; k++) {
+    int nr = r + kNeighbourRows[k];
+    int nc = c + kNeighbourColumns[k];
+    unknown_around_[nr][nc] = static_cast<uint8_t>(unknown_around_[nr][nc] + unknown_delta);
+    marked_around_[nr][nc] = static_cast<uint8_t>(marked_around_[nr][nc] + marked_delta);
+    numbers_around_[nr][nc] = static_cast<uint8_t>(numbers_around_[nr][nc] + number_delta);
+    // The border is no number and never joins the frontier
+    if (IsNumber(client_map_[nr][nc])) {
+      Enqueue(nr, nc);
+    } else if (number_delta != 0) {
+      UpdateFrontier(nr, nc);
+    }
+  }
+  UpdateFrontier(r, c);
+  if (IsNumber(symbol)) {
+    Enqueue(r, c);
+  }
+}
+
+inline void Solver::Enqueue(int r, int c) {
+  if (!(queued_[r][c] & kObviousQueued)) {
+    obvious_queue_.emplace_back(r, c);
+  }
+  if (!(queued_[r][c] & kPairQueued)) {
+    pair_queue_.emplace_back(r, c);
+  }
+  queued_[r][c] = kObviousQueued | kPairQueued;
+}
+
+inline void Solver::UpdateFrontier(int r, int c) {
+  bool on_frontier = client_map_[r][c] == '?' && numbers_around_[r][c] > 0;
+  int index = frontier_index_[r][c];
+  if (on_frontier == (index >= 0)) return;
+  if (on_frontier) {
+    frontier_index_[r][c] = static_cast<int>(frontier_.size());
+    frontier_.emplace_back(r, c);
+  } else {
+    // Move the last block into the hole
+    auto [lr, lc] = frontier_.back();
+    frontier_[index] = {lr, lc};
+    frontier_index_[lr][lc] = index;
+    frontier_.pop_back();
+    frontier_index_[r][c] = -1;
+  }
+}
+
+inline void Solver::CountAdjacent(int r, int c, int &unknown, int &marked, int &total_adj) const {
+  unknown = 0;
+  marked = 0;
+  total_adj = 0;
+
+  const char *centre = &client_map_[r][c];
+  const int *neighbours = client_map_.Neighbours();
+  for (int k = 0; k < 8; k++) {
+    char symbol = centre[neighbours[k]];
+    total_adj += symbol != kBorder;
+    unknown += symbol == '?';
+    marked += symbol == '@';
+  }
+}
+
+inline void Solver::Plan(int r, int c, int type) {
+  if (planned_[r][c]) return;
+  planned_[r][c] = true;
+  pending_.push_back({r, c, type});
+}
+
+inline bool Solver::NextPlanned(Action &action) {
+  while (!pending_.empty()) {
+    action = pending_.front();
+    pending_.pop_front();
+    planned_[action.r][action.c] = false;
+    // An earlier action may have revealed the block already, or all the neighbours to be auto-explored
+    bool useful = action.type == 2 ? unknown_around_[action.r][action.c] > 0 : client_map_[action.r][action.c] == '?';
+    if (useful) return true;
+  }
+  return false;
+}
+
+inline void Solver::FindObviousMoves() {
+  TRACE_SCOPE("Solver::FindObviousMoves");
+  // Look at the numbers whose neighbourhood changed. Once a number's moves are queued it leaves the queue; they
+  // change its neighbourhood, which queues it again.
+  while (!obvious_queue_.empty()) {
+    auto [i, j] = obvious_queue_.front();
+    obvious_queue_.pop_front();
+    queued_[i][j] &= ~kObviousQueued;
+    int mine_count = client_map_[i][j] - '0';
+    int unknown = unknown_around_[i][j];
+    int marked = marked_around_[i][j];
+
+    // If marked mines equal the number, all unknowns are safe
+    if (marked == mine_count && unknown > 0) {
+      // Auto explore this cell
+      Plan(i, j, 2);
+      continue;
+    }
+
+    // If unknown + marked equals the number, all unknowns are mines
+    if (unknown + marked == mine_count && unknown > 0) {
+      // Mark all of the unknown cells
+      for (int k = 0; k < 8; k++) {
+        int nr = i + kNeighbourRows[k];
+        int nc = j + kNeighbourColumns[k];
+        if (client_map_[nr][nc] == '?') {
+          Plan(nr, nc, 1);
+        }
+      }
+    }
+  }
+}
+
+inline void Solver::SolveConstraints() {
+  TRACE_SCOPE("Solver::SolveConstraints");
+  // Compare every queued number with the numbers around it. Each pair is checked in both directions, so it is enough
+  // that one of the two changed. The neighbourhoods are masks over the 7x7 window of unknown blocks around the
+  // queued number, so the common and unique cells of a pair are a few bitwise operations.
+  constexpr int kCentre = BitGrid::kMargin;
+  auto plan_all = [this](int i, int j, uint64_t cells, int type) {
+    for (; cells != 0; cells &= cells - 1) {
+      int bit = __builtin_ctzll(cells);
+      Plan(i + bit / BitGrid::kWindow - kCentre, j + bit % BitGrid::kWindow - kCentre, type);
+    }
+  };
+  while (!pair_queue_.empty()) {
+    auto [i, j] = pair_queue_.front();
+    pair_queue_.pop_front();
+    queued_[i][j] &= ~kPairQueued;
+    if (unknown_around_[i][j] == 0) continue;
+    int remaining_mines_first = client_map_[i][j] - '0' - marked_around_[i][j];
+
+    uint64_t unknown = unknown_bits_.Window(i, j);
+    uint64_t first = unknown & NeighbourMask(WindowBit(0, 0));
+    uint64_t partners = number_bits_.Window(i, j) & kWindowMasks.pairs & ~(uint64_t{1} << WindowBit(0, 0));
+    for (; partners != 0; partners &= partners - 1) {
+      int bit = __builtin_ctzll(partners);
+      int ni = i + bit / BitGrid::kWindow - kCentre;
+      int nj = j + bit % BitGrid::kWindow - kCentre;
+      if (unknown_around_[ni][nj] == 0) continue;
+      int remaining_mines_second = client_map_[ni][nj] - '0' - marked_around_[ni][nj];
+
+      // Find common and unique unknown cells, and look their shape up in the pattern table
+      uint64_t second = unknown & NeighbourMask(bit);
+      uint64_t unique_to_first = first & ~second;
+      uint64_t unique_to_second = second & ~first;
+      uint8_t proven = PairDeductions(__builtin_popcountll(unique_to_first), __builtin_popcountll(unique_to_second),
+                                      __builtin_popcountll(first & second), remaining_mines_first,
+                                      remaining_mines_second);
+      if (proven == 0) continue;
+      // In the order the rules were written in, which is the order of pending_
+      if (proven & kSecondMine) plan_all(i, j, unique_to_second, 1);
+      if (proven & kFirstSafe) plan_all(i, j, unique_to_first, 0);
+      if (proven & kFirstMine) plan_all(i, j, unique_to_first, 1);
+      if (proven & kSecondSafe) plan_all(i, j, unique_to_second, 0);
+    }
+  }
+}
+
+inline size_t Solver::SolveAllPairs() {
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < columns_; j++) {
+      if (IsNumber(client_map_[i][j]) && !(queued_[i][j] & kPairQueued)) {
+        queued_[i][j] |= kPairQueued;
+        pair_queue_.emplace_back(i, j);
+      }
+    }
+  }
+  SolveConstraints();
+  return pending_.size();
+}
+
+inline double Solver::CalculateMineProbability(int r, int c) const {
+  if (client_map_[r][c] != '?') return 2.0; // Invalid
+
+  // Find all adjacent revealed numbers
+  double max_prob = 0.0;
+  double min_prob = 1.0;
+  int constraint_count = 0;
+
+  for (int k = 0; k < 8; k++) {
+    int nr = r + kNeighbourRows[k];
+    int nc = c + kNeighbourColumns[k];
+    if (client_map_[nr][nc] >= '0' && client_map_[nr][nc] <= '8') {
+      int mine_count = client_map_[nr][nc] - '0';
+      int unknown, marked, total_adj;
+      CountAdjacent(nr, nc, unknown, marked, total_adj);
+      if (unknown > 0) {
+        double prob = (double)(mine_count - marked) / unknown;
+        max_prob = (prob > max_prob) ? prob : max_prob;
+        min_prob = (prob < min_prob) ? prob : min_prob;
+        constraint_count++;
+      }
+    }
+  }
+
+  if (constraint_count == 0) {
+    // No constraints, use global probability
+    int total_unknown = 0;
+    int total_unmarked_mines = total_mines_;
+    for (int i = 0; i < rows_; i++) {
+      for (int j = 0; j < columns_; j++) {
+        if (client_map_[i][j] == '?') total_unknown++;
+        if (client_map_[i][j] == '@') total_unmarked_mines--;
+      }
+    }
+    if (total_unknown > 0) {
+      return (double)total_unmarked_mines / total_unknown;
+    }
+    return 0.5;
+  }
+
+  // Use the most pessimistic probability (highest risk)
+  return max_prob;
+}
+
+inline void Solver::BuildConstraints() {
+  // The variables are the frontier blocks; the constraints come from the numbers next to them
+  constraint_numbers_.clear();
+  for (auto [r, c] : frontier_) {
+    for (int k = 0; k < 8; k++) {
+      int nr = r + kNeighbourRows[k];
+      int nc = c + kNeighbourColumns[k];
+      if (IsNumber(client_map_[nr][nc])) {
+        constraint_numbers_.emplace_back(nr, nc);
+      }
+    }
+  }
+  std::sort(constraint_numbers_.begin(), constraint_numbers_.end());
+  constraint_numbers_.erase(std::unique(constraint_numbers_.begin(), constraint_numbers_.end()),
+                            constraint_numbers_.end());
+
+  constraints_.resize(constraint_numbers_.size());
+  for (size_t k = 0; k < constraint_numbers_.size(); k++) {
+    auto [i, j] = constraint_numbers_[k];
+    Constraint &constraint = constraints_[k];
+    constraint.variables.clear();
+    constraint.mines = client_map_[i][j] - '0' - marked_around_[i][j];
+    for (int k = 0; k < 8; k++) {
+      int nr = i + kNeighbourRows[k];
+      int nc = j + kNeighbourColumns[k];
+      if (client_map_[nr][nc] == '?') {
+        constraint.variables.push_back(frontier_index_[nr][nc]);
+      }
+    }
+  }
+}
+
+inline void Solver::SolveLinear() {
+  TRACE_SCOPE("Solver::SolveLinear");
+  int variables = static_cast<int>(frontier_.size());
+  if (!elimination_.Solve(variables, constraints_, unknown_total_ - variables, total_mines_ - marked_total_)) return;
+  for (int k = 0; k < variables; k++) {
+    int value = elimination_.Value(k);
+    if (value >= 0) {
+      Plan(frontier_[k].first, frontier_[k].second, value);
+    }
+  }
+  // The mine count alone may settle the blocks away from the frontier, typically at the end of a game
+  int outside = elimination_.OutsideValue();
+  if (outside < 0) return;
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < columns_; j++) {
+      if (client_map_[i][j] == '?' && frontier_index_[i][j] < 0) {
+        Plan(i, j, outside);
+      }
+    }
+  }
+}
+
+inline bool Solver::ComputeProbabilities() {
+  TRACE_SCOPE("Solver::ComputeProbabilities");
+  TRACE_COUNT("frontier_blocks", frontier_.size());
+  int variables = static_cast<int>(frontier_.size());
+  return engine_.Solve(variables, constraints_, unknown_total_ - variables, total_mines_ - marked_total_);
+}
+
+inline double Solver::GuessProbability(int r, int c, int &score) const {
+  if (frontier_index_[r][c] >= 0) {
+    score = numbers_around_[r][c];
+    return engine_.Probability(frontier_index_[r][c]);
+  }
+  int unknown, marked, total_adj;
+  CountAdjacent(r, c, unknown, marked, total_adj);
+  score = 8 - total_adj;
+  return engine_.OutsideProbability();
+}
+
+inline uint16_t Solver::ProgressValues(int r, int c) const {
+  // The same rules as FindObviousMoves() and SolveConstraints(), with (r, c) as the number and no longer unknown
+  uint64_t unknown = unknown_bits_.Window(r, c) & ~(uint64_t{1} << WindowBit(0, 0));
+  uint64_t own = unknown & NeighbourMask(WindowBit(0, 0));
+  int own_count = __builtin_popcountll(own);
+  if (own_count == 0) return 0;
+  uint16_t progress = 0;
+  for (int shown = marked_around_[r][c]; shown <= 8; shown++) {
+    int remaining = shown - marked_around_[r][c];
+    if (remaining > own_count) break;
+    if (remaining == 0) {
+      progress |= static_cast<uint16_t>(1 << shown);
+      continue;
+    }
+    uint64_t partners = number_bits_.Window(r, c) & kWindowMasks.pairs;
+    for (; partners != 0; partners &= partners - 1) {
+      int bit = __builtin_ctzll(partners);
+      int ni = r + bit / BitGrid::kWindow - BitGrid::kMargin;
+      int nj = c + bit % BitGrid::kWindow - BitGrid::kMargin;
+      int remaining_other = client_map_[ni][nj] - '0' - marked_around_[ni][nj];
+      uint64_t other = unknown & NeighbourMask(bit);
+      int unique_own = __builtin_popcountll(own & ~other);
+      int unique_other = __builtin_popcountll(other & ~own);
+      if ((remaining_other - remaining == unique_other && unique_own > 0) ||
+          (remaining - remaining_other == unique_own && unique_other > 0)) {
+        progress |= static_cast<uint16_t>(1 << shown);
+        break;
+      }
+    }
+  }
+  return progress;
+}
+
+inline bool Solver::RolloutGuess(double min_probability, Action &action) {
+  // Only the best few candidates are sampled, in the order MakeGuess() would prefer them
+  constexpr size_t kMaxCandidates = 64;
+  std::vector<std::pair<std::pair<double, int>, std::pair<int, int>>> ranked;
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < columns_; j++) {
+      if (client_map_[i][j] != '?') continue;
+      int score;
+      double prob = GuessProbability(i, j, score);
+      if (prob <= min_probability + rollout_.Config().margin) {
+        ranked.push_back({{prob, -score}, {i, j}});
+      }
+    }
+  }
+  if (ranked.size() < 2) return false;
+  size_t count = std::min(ranked.size(), kMaxCandidates);
+  std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end());
+  candidates_.resize(count);
+  for (size_t k = 0; k < count; k++) {
+    candidates_[k].r = ranked[k].second.first;
+    candidates_[k].c = ranked[k].second.second;
+    candidates_[k].probability = ranked[k].first.first;
+    candidates_[k].progress = ProgressValues(candidates_[k].r, candidates_[k].c);
+  }
+  int64_t samples = rollout_.Evaluate(engine_, client_map_, frontier_, candidates_);
+  TRACE_COUNT("rollout_samples", samples);
+  if (samples == 0) return false;
+  const RolloutCandidate &best = candidates_[rollout_.Choose(candidates_)];
+  action = {best.r, best.c, 0};
+  return true;
+}
+
+inline bool Solver::MakeGuess(Action &action) {
+  TRACE_SCOPE("Solver::MakeGuess");
+  if (ComputeProbabilities()) {
+    // Blocks that are safe, or mines, in every placement of the mines consistent with the map need no guess
+    for (size_t k = 0; k < frontier_.size(); k++) {
+      if (engine_.IsCertainSafe(static_cast<int>(k))) {
+        Plan(frontier_[k].first, frontier_[k].second, 0);
+      }
+    }
+    for (size_t k = 0; k < frontier_.size(); k++) {
+      if (engine_.IsCertainMine(static_cast<int>(k))) {
+        Plan(frontier_[k].first, frontier_[k].second, 1);
+      }
+    }
+    if (NextPlanned(action)) return true;
+
+    // Visit the safest block. Among blocks that are equally safe, prefer the frontier block with the most adjacent
+    // numbers, or the block away from the frontier with the fewest neighbours, which is the most likely to be a 0.
+    constexpr double kTolerance = 1e-9;
+    int best_r = -1, best_c = -1;
+    double min_probability = 10.0;
+    int best_score = 0;
+    for (int i = 0; i < rows_; i++) {
+      for (int j = 0; j < columns_; j++) {
+        if (client_map_[i][j] != '?') continue;
+        int score;
+        double prob = GuessProbability(i, j, score);
+        if (prob < min_probability - kTolerance || (prob < min_probability + kTolerance && score > best_score)) {
+          min_probability = prob;
+          best_r = i;
+          best_c = j;
+          best_score = score;
+        }
+      }
+    }
+    if (best_r == -1) return false;
+    if (rollout_.Config().enabled && engine_.CanSample() && RolloutGuess(min_probability, action)) return true;
+    action = {best_r, best_c, 0};
+    return true;
+  }
+
+  // The frontier is too large to enumerate: fall back to the local estimate
+  // Strategy: prefer cells with lowest mine probability
+  int best_r = -1, best_c = -1;
+  double min_probability = 10.0;
+  int best_adjacency = -1; // Prefer cells with more adjacent numbers (more info)
+
+  for (int i = 0; i < rows_; i++) {
+    for (int j = 0; j < columns_; j++) {
+      if (client_map_[i][j] == '?') {
+        // Count adjacent revealed numbers
+        int adjacent_numbers = numbers_around_[i][j];
+
+        // Only consider cells with at least one adjacent number
+        if (adjacent_numbers > 0) {
+          double prob = CalculateMineProbability(i, j);
+
+          // Prefer lower probability, break ties with more adjacent numbers
+          if (prob < min_probability ||
+              (prob == min_probability && adjacent_numbers > best_adjacency)) {
+            min_probability = prob;
+            best_r = i;
+            best_c = j;
+            best_adjacency = adjacent_numbers;
+          }
+        }
+      }
+    }
+  }
+
+  // If no cell adjacent to numbers, pick any unknown
+  if (best_r == -1) {
+    // Try to pick a corner or edge cell (often safer)
+    for (int i = 0; i < rows_; i++) {
+      for (int j = 0; j < columns_; j++) {
+        if (client_map_[i][j] == '?') {
+          // Prefer corners, then edges, then center
+          bool is_corner = (i == 0 || i == rows_-1) && (j == 0 || j == columns_-1);
+          bool is_edge = (i == 0 || i == rows_-1 || j == 0 || j == columns_-1);
+
+          if (best_r == -1 || is_corner) {
+            best_r = i;
+            best_c = j;
+            if (is_corner) break;
+          } else if (is_edge && !is_corner) {
+            best_r = i;
+            best_c = j;
+          }
+        }
+      }
+      if (best_r != -1 && ((best_r == 0 || best_r == rows_-1) &&
+                           (best_c == 0 || best_c == columns_-1))) break;
+    }
+  }
+
+  if (best_r == -1) return false;
+  action = {best_r, best_c, 0};
+  return true;
+}
+
+inline bool Solver::Decide(Action &action) {
+  TRACE_SCOPE("Solver::Decide");
+  // Strategy 0: Finish what an earlier pass proved
+  if (NextPlanned(action)) {
+    TRACE_COUNT("solver_passes_per_decision", 0);
+    return true;
+  }
+
+  // Strategy 1: Look for obvious moves (safe cells and mines)
+  FindObviousMoves();
+  if (NextPlanned(action)) {
+    TRACE_COUNT("solver_passes_per_decision", 1);
+    return true;
+  }
+
+  // Strategy 2: Advanced constraint solving
+  SolveConstraints();
+  if (NextPlanned(action)) {
+    TRACE_COUNT("solver_passes_per_decision", 2);
+    return true;
+  }
+
+  // Strategy 3: Deductions that need several numbers at once, or the mine count, before anything is enumerated. The
+  // constraints are built once for this stage and the next.
+  BuildConstraints();
+  SolveLinear();
+  if (NextPlanned(action)) {
+    TRACE_COUNT("solver_passes_per_decision", 3);
+    return true;
+  }
+
+  // Strategy 4: Make an educated guess
+  TRACE_COUNT("solver_passes_per_decision", 4);
+  return MakeGuess(action);
+}
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * This header file provides a lock-free ring buffer between exactly one producer thread and one consumer thread, such
+ * as the two halves of a pipelined game in harness.h.
+ */
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief A bounded queue of up to Capacity values, for one producer and one consumer
+ *
+ * @details The producer only writes tail_ and the consumer only writes head_, each with a release store that publishes
+ * the slots before it, so neither side ever takes a lock while the other keeps up. Each side also keeps the last index
+ * it read of the other side's counter and only reloads it when the ring looks full or empty, which keeps the two cache
+ * lines from bouncing on every operation. Push() and Pop() wait by spinning briefly, then yielding, then sleeping on a
+ * condition variable until the other side makes progress, so an idle side costs no core at all. Every successful
+ * operation checks whether the other side sleeps with a read-modify-write of its flag, and the sleeper raises the flag
+ * with one before its last try. The two are ordered one way or the other, so either the sleeper's try sees the
+ * operation or the operation sees the flag, and no wakeup is lost.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+ public:
+  // Producer side. TryPush() returns false if the ring is full.
+  bool TryPush(const T &value);
+  void Push(const T &value);
+  // Consumer side. TryPop() returns false if the ring is empty.
+  bool TryPop(T &value);
+  T Pop();
+
+ private:
+  static constexpr int kSpins = 64;   // Polls before a waiting side yields its core
+  static constexpr int kYields = 16;  // Yields before it goes to sleep
+
+  // Where one side sleeps: the producer on space_ while the ring is full, the consumer on items_ while it is empty
+  struct alignas(64) Sleeper {
+    std::atomic<uint32_t> sleeping{0};
+    std::mutex mutex;
+    std::condition_variable wakeup;
+  };
+
+  // TryPush() and TryPop() without waking the other side
+  bool PushOnce(const T &value);
+  bool PopOnce(T &value);
+  // Call attempt until it returns true, sleeping on sleeper once spinning and yielding have not been enough
+  template <typename Attempt>
+  static void Wait(Sleeper &sleeper, Attempt attempt);
+  // Wake the side sleeping on sleeper, if any
+  static void Notify(Sleeper &sleeper);
+
+  alignas(64) std::atomic<size_t> head_{0};  // Next slot to pop
+  size_t cached_tail_ = 0;                   // The consumer's copy of tail_
+  alignas(64) std::atomic<size_t> tail_{0};  // Next slot to push
+  size_t cached_head_ = 0;                   // The producer's copy of head_
+  alignas(64) std::array<T, Capacity> slots_{};
+  Sleeper space_;
+  Sleeper items_;
+};
+
+template <typename T, size_t Capacity>
+inline bool SpscRing<T, Capacity>::PushOnce(const T &value) {
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail - cached_head_ == Capacity) {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    if (tail - cached_head_ == Capacity) return false;
+  }
+  slots_[tail & (Capacity - 1)] = value;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+inline bool SpscRing<T, Capacity>::TryPush(const T &value) {
+  if (!PushOnce(value)) return false;
+  Notify(items_);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+inline void SpscRing<T, Capacity>::Push(const T &value) {
+  Wait(space_, [&] { return PushOnce(value); });
+  Notify(items_);
+}
+
+template <typename T, size_t Capacity>
+inline bool SpscRing<T, Capacity>::PopOnce(T &value) {
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head == cached_tail_) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (head == cached_tail_) return false;
+  }
+  value = slots_[head & (Capacity - 1)];
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+inline bool SpscRing<T, Capacity>::TryPop(T &value) {
+  if (!PopOnce(value)) return false;
+  Notify(space_);
+  return true;
+}
+
+template <typename T, size_t Capacity>
+inline T SpscRing<T, Capacity>::Pop() {
+  T value;
+  Wait(items_, [&] { return PopOnce(value); });
+  Notify(space_);
+  return value;
+}
+
+template <typename T, size_t Capacity>
+template <typename Attempt>
+inline void SpscRing<T, Capacity>::Wait(Sleeper &sleeper, Attempt attempt) {
+  for (int k = 0; k < kSpins + kYields; k++) {
+    if (attempt()) return;
+    if (k >= kSpins) std::this_thread::yield();
+  }
+  std::unique_lock<std::mutex> lock(sleeper.mutex);
+  sleeper.sleeping.exchange(1, std::memory_order_acq_rel);
+  while (!attempt()) {
+    sleeper.wakeup.wait(lock);
+  }
+  sleeper.sleeping.store(0, std::memory_order_relaxed);
+}
+
+template <typename T, size_t Capacity>
+inline void SpscRing<T, Capacity>::Notify(Sleeper &sleeper) {
+  // Pairs with the exchange in Wait(): if this comes first, the sleeper's last try sees this operation
+  if (sleeper.sleeping.fetch_add(0, std::memory_order_acq_rel) == 0) return;
+  // The sleeper holds the mutex from before its last try until it waits, so the notification cannot come too early
+  std::lock_guard<std::mutex> lock(sleeper.mutex);
+  sleeper.wakeup.notify_one();
+}
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * This header file provides a small work-stealing thread pool for running many independent tasks, such as the games of
+ * a batch evaluation.
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that run a batch of indexed tasks.
+ *
+ * @details Run() splits [0, count) into one contiguous range per worker. A worker takes indices from the front of its
+ * own range; once that is empty it steals the back half of the largest range it can find. Long tasks therefore do
+ * not leave the other workers idle, while the common case touches only the worker's own lock.
+ */
+class ThreadPool {
+ public:
+  // Start threads workers. 0 means one per hardware thread.
+  explicit ThreadPool(int threads = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  int Size() const { return static_cast<int>(threads_.size()); }
+
+  /**
+   * @brief Call task(index, worker) for every index in [0, count) and wait for all of them to finish
+   * @details worker is in [0, Size()) and identifies the calling thread, so tasks can keep per-worker state.
+   */
+  void Run(size_t count, const std::function<void(size_t, int)> &task);
+
+ private:
+  struct alignas(64) Range {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  void WorkerLoop(int worker);
+  // Take the next index for worker, stealing from another worker if its own range is empty
+  bool Next(int worker, size_t &index);
+
+  std::vector<std::thread> threads_;
+  std::unique_ptr<Range[]> ranges_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t, int)> *task_ = nullptr;
+  uint64_t generation_ = 0;  // Incremented by every Run(), so workers can tell a new batch from a spurious wakeup
+  int running_ = 0;          // Workers still busy with the current batch
+  bool stop_ = false;
+};
+
+inline ThreadPool::ThreadPool(int threads) {
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+  }
+  ranges_.reset(new Range[threads]);
+  for (int k = 0; k < threads; k++) {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, k);
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+inline void ThreadPool::Run(size_t count, const std::function<void(size_t, int)> &task) {
+  size_t workers = threads_.size();
+  for (size_t k = 0; k < workers; k++) {
+    std::lock_guard<std::mutex> lock(ranges_[k].mutex);
+    ranges_[k].begin = count * k / workers;
+    ranges_[k].end = count * (k + 1) / workers;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_ = &task;
+  running_ = static_cast<int>(workers);
+  generation_++;
+  wake_.notify_all();
+  done_.wait(lock, [this] { return running_ == 0; });
+  task_ = nullptr;
+}
+
+inline bool ThreadPool::Next(int worker, size_t &index) {
+  {
+    Range &own = ranges_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin < own.end) {
+      index = own.begin++;
+      return true;
+    }
+  }
+  int workers = Size();
+  while (true) {
+    // Pick the victim with the most work left. The sizes may change meanwhile, which only makes the choice worse.
+    int victim = -1;
+    size_t most = 0;
+    for (int k = 1; k < workers; k++) {
+      Range &range = ranges_[(worker + k) % workers];
+      std::lock_guard<std::mutex> lock(range.mutex);
+      if (range.end - range.begin > most) {
+        most = range.end - range.begin;
+        victim = (worker + k) % workers;
+      }
+    }
+    if (victim == -1) return false;
+
+    size_t begin, end;
+    {
+      Range &range = ranges_[victim];
+      std::lock_guard<std::mutex> lock(range.mutex);
+      if (range.begin >= range.end) continue;
+      size_t take = (range.end - range.begin + 1) / 2;
+      begin = range.end - take;
+      end = range.end;
+      range.end = begin;
+    }
+    Range &own = ranges_[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = begin + 1;
+    own.end = end;
+    index = begin;
+    return true;
+  }
+}
+
+inline void ThreadPool::WorkerLoop(int worker) {
+  uint64_t seen = 0;
+  while (true) {
+    const std::function<void(size_t, int)> *task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+      task = task_;
+    }
+    size_t index;
+    while (Next(worker, index)) {
+      (*task)(index, worker);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--running_ == 0) {
+      done_.notify_all();
+    }
+  }
+}
+
+#endif
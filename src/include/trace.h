@@ -0,0 +1,229 @@
+/**
+ * This header file holds the instrumentation of the hot paths of the server and the client: scoped timers that feed a
+ * latency histogram per operation, and counters with a histogram of the values they see. It is compiled in only when
+ * MINESWEEPER_TRACE is defined (configure with -DMINESWEEPER_TRACE=ON); otherwise the macros below expand to nothing
+ * and no code or data is left behind.
+ *
+ *     TRACE_SCOPE(name)          time the rest of the enclosing scope as the operation name
+ *     TRACE_COUNT(name, value)   record value for the counter name
+ *     TRACE_DUMP()               write everything recorded so far as JSON, to the file named by the environment
+ *                                variable MINESWEEPER_TRACE_FILE, or to stderr
+ *
+ * Timers read the time stamp counter where there is one, and steady_clock elsewhere. Every site registers itself once,
+ * on first use, and then only does a few relaxed atomic additions, so the instrumentation may stay on in production
+ * runs, with several threads recording at once.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef MINESWEEPER_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Ticks of the time stamp counter, or nanoseconds of steady_clock where there is none
+inline uint64_t TraceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/**
+ * @brief Counts of values in power-of-two buckets
+ * @details Bucket 0 holds the zeros and bucket k > 0 the values in [2^(k - 1), 2^k), so the percentiles are known up to
+ * a factor of 2, which is enough to see where time goes and to catch regressions.
+ */
+class TraceHistogram {
+ public:
+  static constexpr int kBuckets = 65;
+
+  void Record(uint64_t value) {
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+  uint64_t Bucket(int k) const { return buckets_[k].load(std::memory_order_relaxed); }
+  // Largest value of bucket k
+  static uint64_t UpperBound(int k) { return k == 0 ? 0 : k == 64 ? UINT64_MAX : (uint64_t{1} << k) - 1; }
+  // Upper bound of the bucket that holds the given fraction of the values
+  uint64_t Percentile(double fraction) const;
+
+ private:
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+  std::atomic<uint64_t> buckets_[kBuckets] = {};
+};
+
+// One instrumented operation or counter
+struct TraceSite {
+  const char *name;
+  bool timer;
+  TraceHistogram histogram;
+};
+
+// All the sites of the process
+class TraceRegistry {
+ public:
+  static TraceRegistry &Instance() {
+    static TraceRegistry registry;
+    return registry;
+  }
+
+  // The site called name, created on the first call. Sites of the same name share their records.
+  TraceSite *Register(const char *name, bool timer);
+  // Write all the sites as JSON. Timers are converted to nanoseconds.
+  void Dump(std::FILE *out);
+
+ private:
+  TraceRegistry() : start_ticks_(TraceTicks()), start_time_(std::chrono::steady_clock::now()) {}
+  // Nanoseconds per tick of TraceTicks(), measured against steady_clock since the registry was created
+  double NanosecondsPerTick();
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<TraceSite>> sites_;
+  uint64_t start_ticks_;
+  std::chrono::steady_clock::time_point start_time_;
+};
+
+// Records the time from its construction to its destruction
+class TraceTimer {
+ public:
+  explicit TraceTimer(TraceSite *site) : site_(site), start_(TraceTicks()) {}
+  ~TraceTimer() { site_->histogram.Record(TraceTicks() - start_); }
+  TraceTimer(const TraceTimer &) = delete;
+  TraceTimer &operator=(const TraceTimer &) = delete;
+
+ private:
+  TraceSite *site_;
+  uint64_t start_;
+};
+
+inline uint64_t TraceHistogram::Percentile(double fraction) const {
+  uint64_t count = Count();
+  if (count == 0) return 0;
+  uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count));
+  uint64_t seen = 0;
+  for (int k = 0; k < kBuckets; k++) {
+    seen += Bucket(k);
+    if (seen > rank) return UpperBound(k);
+  }
+  return Max();
+}
+
+inline TraceSite *TraceRegistry::Register(const char *name, bool timer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &site : sites_) {
+    if (std::strcmp(site->name, name) == 0) return site.get();
+  }
+  sites_.emplace_back(new TraceSite{name, timer, {}});
+  return sites_.back().get();
+}
+
+inline double TraceRegistry::NanosecondsPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+  // Make sure the measurement spans at least 10 ms
+  auto now = std::chrono::steady_clock::now();
+  while (now - start_time_ < std::chrono::milliseconds(10)) {
+    now = std::chrono::steady_clock::now();
+  }
+  uint64_t ticks = TraceTicks() - start_ticks_;
+  return std::chrono::duration<double, std::nano>(now - start_time_).count() / static_cast<double>(ticks);
+#else
+  return 1.0;
+#endif
+}
+
+inline void TraceRegistry::Dump(std::FILE *out) {
+  double scale = NanosecondsPerTick();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto write_sites = [&](bool timers) {
+    const char *unit = timers ? "_ns" : "";
+    double factor = timers ? scale : 1.0;
+    bool first = true;
+    for (const auto &site : sites_) {
+      if (site->timer != timers) continue;
+      const TraceHistogram &histogram = site->histogram;
+      uint64_t count = histogram.Count();
+      std::fprintf(out, "%s\n    \"%s\": {\"count\": %llu", first ? "" : ",", site->name,
+                   static_cast<unsigned long long>(count));
+      std::fprintf(out, ", \"total%s\": %.0f, \"mean%s\": %.1f, \"max%s\": %.0f", unit, histogram.Sum() * factor, unit,
+                   count > 0 ? histogram.Sum() * factor / count : 0.0, unit, histogram.Max() * factor);
+      for (double fraction : {0.5, 0.9, 0.99}) {
+        std::fprintf(out, ", \"p%d%s\": %.0f", static_cast<int>(fraction * 100), unit,
+                     histogram.Percentile(fraction) * factor);
+      }
+      // Only the buckets that are not empty, as [largest value, count]
+      std::fprintf(out, ", \"histogram%s\": [", unit);
+      bool first_bucket = true;
+      for (int k = 0; k < TraceHistogram::kBuckets; k++) {
+        if (histogram.Bucket(k) == 0) continue;
+        std::fprintf(out, "%s[%.0f, %llu]", first_bucket ? "" : ", ", TraceHistogram::UpperBound(k) * factor,
+                     static_cast<unsigned long long>(histogram.Bucket(k)));
+        first_bucket = false;
+      }
+      std::fprintf(out, "]}");
+      first = false;
+    }
+  };
+  std::fprintf(out, "{\n  \"timers\": {");
+  write_sites(true);
+  std::fprintf(out, "\n  },\n  \"counters\": {");
+  write_sites(false);
+  std::fprintf(out, "\n  }\n}\n");
+  std::fflush(out);
+}
+
+inline void TraceDump() {
+  const char *path = std::getenv("MINESWEEPER_TRACE_FILE");
+  std::FILE *out = path != nullptr ? std::fopen(path, "w") : nullptr;
+  TraceRegistry::Instance().Dump(out != nullptr ? out : stderr);
+  if (out != nullptr) std::fclose(out);
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)                                                                                     \
+  static TraceSite *const TRACE_CONCAT(trace_site_, __LINE__) = TraceRegistry::Instance().Register(name, true); \
+  TraceTimer TRACE_CONCAT(trace_timer_, __LINE__)(TRACE_CONCAT(trace_site_, __LINE__))
+#define TRACE_COUNT(name, value)                                                           \
+  do {                                                                                     \
+    static TraceSite *const trace_site = TraceRegistry::Instance().Register(name, false); \
+    trace_site->histogram.Record(static_cast<uint64_t>(value));                           \
+  } while (0)
+#define TRACE_DUMP() TraceDump()
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_COUNT(name, value) \
+  do {                           \
+  } while (0)
+#define TRACE_DUMP() \
+  do {               \
+  } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * This header file holds the binary wire protocol of the server, an opt-in alternative to the text protocol for
+ * harnesses that drive the server through a pipe. All the fields are little-endian.
+ *
+ * Input:
+ *     WireMapHeader        rows and columns of the map
+ *     mine bitset          (rows * columns + 7) / 8 bytes; bit k % 8 of byte k / 8 is set if block k (row-major) is a
+ *                          mine
+ *     WireCommand ...      one fixed-size record per operation, until the game ends or the input does
+ * Output: one frame for the initial map and one after every operation, each a WireFrameHeader followed by
+ * payload_bytes bytes of cells, encoded as
+ *     kPacked              one 4-bit WireSymbol() per block in row-major order, the even blocks in the low nibble
+ *     kRunLength           the blocks changed since the previous frame (or since the all-'?' map, for the first
+ *                          frame) in row-major order, as (run, symbol byte) pairs: run is a LEB128 varint counting
+ *                          the unchanged blocks skipped since the previous changed block
+ * The frame of the operation that ends the game carries the result, and the server stops after it.
+ *
+ * Input and output go through buffered file descriptors. Output is flushed only when no complete command is waiting,
+ * so a harness that sends its commands ahead gets all the frames with a handful of system calls.
+ */
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "game.h"
+
+struct WireMapHeader {
+  int32_t rows;
+  int32_t columns;
+};
+
+struct WireCommand {
+  int32_t row;
+  int32_t column;
+  int32_t type;  // 0 for VisitBlock, 1 for MarkMine and 2 for AutoExplore
+};
+
+enum WireEncoding : uint8_t { kPacked = 1, kRunLength = 2 };
+
+struct WireFrameHeader {
+  uint8_t encoding;
+  int8_t state;               // 0 for continuing, 1 for winning, -1 for losing
+  uint16_t reserved;
+  int32_t visit_count;
+  int32_t marked_mine_count;  // As PrintResult() reports it: all the mines after winning
+  uint32_t payload_bytes;
+};
+
+static_assert(sizeof(WireMapHeader) == 8 && sizeof(WireCommand) == 12 && sizeof(WireFrameHeader) == 16,
+              "Wire records must have no padding");
+
+// The 4-bit code of a map symbol: 0-8 for numbers, then '?', '@' and 'X'
+inline uint8_t WireSymbol(char symbol) {
+  switch (symbol) {
+    case '?':
+      return 9;
+    case '@':
+      return 10;
+    case 'X':
+      return 11;
+    default:
+      return static_cast<uint8_t>(symbol - '0');
+  }
+}
+
+inline char WireSymbolChar(uint8_t code) { return "012345678?@X"[code]; }
+
+// Reads from a file descriptor through a buffer
+class FdReader {
+ public:
+  explicit FdReader(int fd, size_t capacity = 1 << 16) : fd_(fd), buffer_(capacity) {}
+
+  // Read exactly size bytes. Returns false at the end of the input or on an error.
+  bool ReadExact(void *data, size_t size);
+  // Bytes read from the descriptor but not consumed yet
+  size_t Buffered() const { return end_ - begin_; }
+
+ private:
+  int fd_;
+  std::vector<char> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};
+
+// Writes to a file descriptor through a buffer. Flushed when full, on Flush() and on destruction.
+class FdWriter {
+ public:
+  explicit FdWriter(int fd, size_t capacity = 1 << 16) : fd_(fd) { buffer_.reserve(capacity); }
+  ~FdWriter() { Flush(); }
+  FdWriter(const FdWriter &) = delete;
+  FdWriter &operator=(const FdWriter &) = delete;
+
+  void Write(const void *data, size_t size);
+  void Flush();
+
+ private:
+  int fd_;
+  std::vector<char> buffer_;
+};
+
+/**
+ * @brief Keeps the map in the packed encoding and writes it as frames
+ * @details Only the blocks changed since the last frame are repacked, so a kPacked frame costs a copy of half a byte
+ * per block, and a kRunLength frame is proportional to the number of changed blocks.
+ */
+class FrameEncoder {
+ public:
+  // Start a new game on a rows * columns map, all '?'
+  void Reset(int rows, int columns);
+  // Bring the packed map up to date with game and write one frame
+  void Encode(Game &game, WireEncoding encoding, FdWriter &out);
+
+ private:
+  size_t blocks_ = 0;
+  int columns_ = 0;
+  std::vector<uint8_t> packed_;
+  std::vector<size_t> changed_;  // Row-major indices of the blocks changed since the last frame
+  std::vector<uint8_t> payload_;
+};
+
+inline bool FdReader::ReadExact(void *data, size_t size) {
+  char *target = static_cast<char *>(data);
+  while (size > 0) {
+    if (begin_ == end_) {
+      ssize_t got = ::read(fd_, buffer_.data(), buffer_.size());
+      if (got < 0 && errno == EINTR) continue;
+      if (got <= 0) return false;
+      begin_ = 0;
+      end_ = static_cast<size_t>(got);
+    }
+    size_t take = end_ - begin_ < size ? end_ - begin_ : size;
+    std::memcpy(target, buffer_.data() + begin_, take);
+    begin_ += take;
+    target += take;
+    size -= take;
+  }
+  return true;
+}
+
+inline void FdWriter::Write(const void *data, size_t size) {
+  if (buffer_.size() + size > buffer_.capacity()) {
+    Flush();
+  }
+  const char *source = static_cast<const char *>(data);
+  buffer_.insert(buffer_.end(), source, source + size);
+}
+
+inline void FdWriter::Flush() {
+  size_t done = 0;
+  while (done < buffer_.size()) {
+    ssize_t written = ::write(fd_, buffer_.data() + done, buffer_.size() - done);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) break;
+    done += static_cast<size_t>(written);
+  }
+  buffer_.clear();
+}
+
+inline void FrameEncoder::Reset(int rows, int columns) {
+  blocks_ = static_cast<size_t>(rows) * columns;
+  columns_ = columns;
+  // Two '?' per byte
+  packed_.assign((blocks_ + 1) / 2, 0x99);
+}
+
+inline void FrameEncoder::Encode(Game &game, WireEncoding encoding, FdWriter &out) {
+  changed_.clear();
+  for (auto [r, c] : game.CollectDirtyBlocks()) {
+    size_t k = static_cast<size_t>(r) * columns_ + c;
+    int shift = (k & 1) * 4;
+    uint8_t kept = packed_[k >> 1] & static_cast<uint8_t>(0xf0 >> shift);
+    packed_[k >> 1] = static_cast<uint8_t>(kept | WireSymbol(game.Symbol(r, c)) << shift);
+    changed_.push_back(k);
+  }
+
+  const uint8_t *payload = packed_.data();
+  size_t payload_bytes = packed_.size();
+  if (encoding == kRunLength) {
+    std::sort(changed_.begin(), changed_.end());
+    payload_.clear();
+    size_t next = 0;  // The block after the last one written
+    for (size_t k : changed_) {
+      for (size_t run = k - next;; run >>= 7) {
+        if (run < 0x80) {
+          payload_.push_back(static_cast<uint8_t>(run));
+          break;
+        }
+        payload_.push_back(static_cast<uint8_t>((run & 0x7f) | 0x80));
+      }
+      payload_.push_back((packed_[k >> 1] >> ((k & 1) * 4)) & 0xf);
+      next = k + 1;
+    }
+    payload = payload_.data();
+    payload_bytes = payload_.size();
+  }
+
+  WireFrameHeader header{};
+  header.encoding = encoding;
+  header.state = static_cast<int8_t>(game.State());
+  header.visit_count = game.VisitCount();
+  header.marked_mine_count = game.State() == 1 ? game.TotalMines() : game.MarkedMineCount();
+  header.payload_bytes = static_cast<uint32_t>(payload_bytes);
+  out.Write(&header, sizeof(header));
+  out.Write(payload, payload_bytes);
+}
+
+/**
+ * @brief Play one game over the binary protocol
+ * @details Read the map and the commands from in and write the frames to out, until the game ends or the input does.
+ * Returns false if the input ended before the map was complete.
+ */
+inline bool ServeBinary(Game &game, FdReader &in, FdWriter &out, WireEncoding encoding) {
+  WireMapHeader map;
+  if (!in.ReadExact(&map, sizeof(map))) return false;
+  std::vector<uint8_t> bits((static_cast<size_t>(map.rows) * map.columns + 7) / 8);
+  if (!in.ReadExact(bits.data(), bits.size())) return false;
+  game.Reset(map.rows, map.columns);
+  for (int i = 0; i < map.rows; i++) {
+    for (int j = 0; j < map.columns; j++) {
+      size_t k = static_cast<size_t>(i) * map.columns + j;
+      if (bits[k >> 3] >> (k & 7) & 1) {
+        game.PlaceMine(i, j);
+      }
+    }
+  }
+  game.Start();
+
+  FrameEncoder encoder;
+  encoder.Reset(map.rows, map.columns);
+  encoder.Encode(game, encoding, out);
+  while (game.State() == 0) {
+    // Only wait for the next command once everything answered so far is on its way
+    if (in.Buffered() < sizeof(WireCommand)) {
+      out.Flush();
+    }
+    WireCommand command;
+    if (!in.ReadExact(&command, sizeof(command))) break;
+    game.Apply(command.row, command.column, command.type);
+    encoder.Encode(game, encoding, out);
+  }
+  out.Flush();
+  return true;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "corpus.h"
+#include "game.h"
+
+/**
+ * A server that hosts many games in one process. Every command names the game it belongs to, so the games can be
+ * interleaved freely on the same input stream:
+ *     NEW id n m          followed by the n lines of the map, like the input of basic.cpp. Starts game id.
+ *     OP id x y type      applies an operation to game id, like a line of operations in basic.cpp.
+ *     END id              drops game id before it is over.
+ *     MAP id k            starts game id on map k of the corpus given with --corpus file (see corpus.h), with no
+ *                         parsing. Answered like NEW.
+ * Every reply starts with a line holding the id, followed by the map exactly as basic.cpp prints it. When an
+ * operation ends a game, the result lines follow the map and the id becomes free again.
+ *
+ * Run it with --diff to print the blocks changed by each operation instead of the whole map (see Game::PrintDiff()),
+ * and with --corpus file to allow MAP commands.
+ *
+ * Finished games go back to a pool and are reset for the next NEW command, so a long-running process does not
+ * allocate once its pool has grown to the number of games open at the same time.
+ */
+
+namespace {
+
+std::vector<std::unique_ptr<Game>> idle_games;                // Finished games, ready to be reset
+std::unordered_map<uint64_t, std::unique_ptr<Game>> sessions;  // Games in progress, by id
+
+std::unique_ptr<Game> AcquireGame() {
+  if (idle_games.empty()) {
+    return std::make_unique<Game>();
+  }
+  std::unique_ptr<Game> game = std::move(idle_games.back());
+  idle_games.pop_back();
+  return game;
+}
+
+void ReleaseGame(uint64_t id) {
+  auto it = sessions.find(id);
+  if (it == sessions.end()) return;
+  idle_games.push_back(std::move(it->second));
+  sessions.erase(it);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+  bool diff_mode = false;
+  Corpus corpus;
+  for (int k = 1; k < argc; k++) {
+    if (std::strcmp(argv[k], "--diff") == 0) {
+      diff_mode = true;
+    } else if (std::strcmp(argv[k], "--corpus") == 0 && k + 1 < argc) {
+      if (!corpus.Open(argv[++k])) {
+        std::cerr << "Invalid corpus file = " << argv[k] << std::endl;
+        return -1;
+      }
+    }
+  }
+  std::string command;
+  while (std::cin >> command) {
+    uint64_t id;
+    std::cin >> id;
+    if (command == "NEW") {
+      int n, m;
+      std::cin >> n >> m;
+      ReleaseGame(id);
+      std::unique_ptr<Game> game = AcquireGame();
+      game->Read(n, m, std::cin);
+      std::cout << id << '\n';
+      game->PrintMap(std::cout);
+      sessions[id] = std::move(game);
+    } else if (command == "OP") {
+      int x, y, type;
+      std::cin >> x >> y >> type;
+      auto it = sessions.find(id);
+      if (it == sessions.end()) {
+        std::cerr << "Unknown game id = " << id << std::endl;
+        continue;
+      }
+      Game &game = *it->second;
+      game.Apply(x, y, type);
+      std::cout << id << '\n';
+      if (diff_mode) {
+        game.PrintDiff(std::cout);
+      } else {
+        game.PrintMap(std::cout);
+      }
+      if (game.State() != 0) {
+        game.PrintResult(std::cout);
+        ReleaseGame(id);
+      }
+    } else if (command == "MAP") {
+      size_t k;
+      std::cin >> k;
+      if (k >= corpus.Size()) {
+        std::cerr << "Unknown map = " << k << std::endl;
+        continue;
+      }
+      ReleaseGame(id);
+      std::unique_ptr<Game> game = AcquireGame();
+      corpus.Load(k, *game);
+      std::cout << id << '\n';
+      game->PrintMap(std::cout);
+      sessions[id] = std::move(game);
+    } else if (command == "END") {
+      ReleaseGame(id);
+    } else {
+      std::cerr << "Invalid command = " << command << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,12 @@
+#include <iostream>
+
+// Built against the single-file submissions of cmake/Bundle.cmake, not src/include, to show that each of them compiles
+// on its own. Both are included, as advanced.cpp does; Execute() is the part the judge's main file provides.
+#include "server.h"
+#include "client.h"
+
+void Execute(int r, int c, int type) {
+  std::cerr << "Execute(" << r << ", " << c << ", " << type << ") is not available in the submission check\n";
+}
+
+int main() { return 0; }
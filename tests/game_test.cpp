@@ -0,0 +1,131 @@
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "wire.h"
+
+/**
+ * Tests of the rendering of Game and of the kRunLength frames built from it, around Rollback(). Each check prints
+ * what failed; the exit code is the number of failed checks.
+ */
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const std::string &what) {
+  if (!condition) {
+    std::printf("FAILED: %s\n", what.c_str());
+    failures++;
+  }
+}
+
+// Apply the kRunLength frames of a whole file to map, which starts all '?'. Returns false if a frame is malformed.
+bool DecodeFrames(int fd, int rows, int columns, std::vector<char> &map, int &frames) {
+  size_t blocks = static_cast<size_t>(rows) * columns;
+  map.assign(blocks, '?');
+  frames = 0;
+  FdReader in(fd);
+  WireFrameHeader header;
+  while (in.ReadExact(&header, sizeof(header))) {
+    if (header.encoding != kRunLength) return false;
+    std::vector<uint8_t> payload(header.payload_bytes);
+    if (!in.ReadExact(payload.data(), payload.size())) return false;
+    size_t next = 0;
+    for (size_t k = 0; k < payload.size();) {
+      uint64_t run = 0;
+      for (int shift = 0;; shift += 7) {
+        if (k == payload.size() || shift > 63) return false;
+        uint8_t byte = payload[k++];
+        run |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) break;
+      }
+      if (k == payload.size() || run >= blocks - next) return false;
+      next += run;
+      map[next++] = WireSymbolChar(payload[k++]);
+    }
+    frames++;
+  }
+  return true;
+}
+
+// A 4 x 4 map with mines at (0, 3) and (3, 3): visiting (0, 0) floods most of the map, but does not win
+void SetUp(Game &game) {
+  game.Reset(4, 4);
+  game.PlaceMine(0, 3);
+  game.PlaceMine(3, 3);
+  game.Start();
+}
+
+// Roll back past a render, replay the same move and render again: every block goes on the dirty list once
+void TestRollbackPastRender() {
+  Game game;
+  SetUp(game);
+  game.CollectDirtyBlocks();
+  GameCheckpoint checkpoint = game.Checkpoint();
+  game.VisitBlock(0, 0);
+  size_t changed = game.CollectDirtyBlocks().size();
+  game.Rollback(checkpoint);
+  game.VisitBlock(0, 0);
+  const std::vector<std::pair<int, int>> &dirty = game.CollectDirtyBlocks();
+  std::set<std::pair<int, int>> unique(dirty.begin(), dirty.end());
+  Check(unique.size() == dirty.size(), "dirty list after a rollback past a render has duplicates");
+  Check(dirty.size() == changed, "dirty list after a rollback past a render has the wrong size");
+
+  std::ostringstream diff;
+  game.Rollback(checkpoint);
+  game.VisitBlock(0, 0);
+  game.PrintDiff(diff);
+  Check(diff.str().substr(0, diff.str().find('\n')) == std::to_string(changed),
+        "PrintDiff() after a rollback past a render prints a block twice");
+}
+
+// The same sequence through FrameEncoder: the kRunLength frames must decode to the map as the game shows it
+void TestRunLengthAfterRollback() {
+  Game game;
+  SetUp(game);
+  FILE *file = std::tmpfile();
+  int fd = fileno(file);
+  {
+    FdWriter out(fd);
+    FrameEncoder encoder;
+    encoder.Reset(game.Rows(), game.Columns());
+    encoder.Encode(game, kRunLength, out);
+    GameCheckpoint checkpoint = game.Checkpoint();
+    game.VisitBlock(0, 0);
+    encoder.Encode(game, kRunLength, out);
+    game.Rollback(checkpoint);
+    game.VisitBlock(0, 0);
+    encoder.Encode(game, kRunLength, out);
+    game.MarkMine(3, 3);
+    encoder.Encode(game, kRunLength, out);
+  }
+  lseek(fd, 0, SEEK_SET);
+  std::vector<char> map;
+  int frames = 0;
+  Check(DecodeFrames(fd, game.Rows(), game.Columns(), map, frames), "kRunLength frames after a rollback are malformed");
+  Check(frames == 4, "expected 4 kRunLength frames, got " + std::to_string(frames));
+  for (int i = 0; i < game.Rows(); i++) {
+    for (int j = 0; j < game.Columns(); j++) {
+      Check(map[static_cast<size_t>(i) * game.Columns() + j] == game.Symbol(i, j),
+            "decoded block (" + std::to_string(i) + ", " + std::to_string(j) + ") differs from the game");
+    }
+  }
+  std::fclose(file);
+}
+
+}  // namespace
+
+int main() {
+  TestRollbackPastRender();
+  TestRunLengthAfterRollback();
+  if (failures == 0) std::printf("all checks passed\n");
+  return failures;
+}